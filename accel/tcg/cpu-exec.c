@@ -206,17 +206,23 @@ static bool tb_lookup_cmp(const void *p, const void *d)
         } else {
             tb_page_addr_t phys_page1;
             vaddr virt_page1;
+            void *host;
+            int flags;
 
             /*
-             * We know that the first page matched, and an otherwise valid TB
-             * encountered an incomplete instruction at the end of that page,
-             * therefore we know that generating a new TB from the current PC
-             * must also require reading from the next page -- even if the
-             * second pages do not match, and therefore the resulting insn
-             * is different for the new TB.  Therefore any exception raised
-             * here by the faulting lookup is not premature.
+             * The TB may contain several insns on the first page before
+             * the one that reaches into the second, so an exception for
+             * the second page would be premature here.  Probe without
+             * faulting; on failure, translating anew from the current PC
+             * raises the exception at the right insn.
              */
             virt_page1 = TARGET_PAGE_ALIGN(desc->pc);
+            flags = probe_access_flags(desc->env, virt_page1, 0, MMU_INST_FETCH,
+                                       cpu_mmu_index(env_cpu(desc->env), true),
+                                       true, &host, 0);
+            if (flags & TLB_INVALID_MASK) {
+                return false;
+            }
             phys_page1 = get_page_addr_code(desc->env, virt_page1);
             if (tb_phys_page1 == phys_page1) {
                 return true;
@@ -688,6 +694,29 @@ static inline void tb_add_jump(TranslationBlock *tb, int n,
     return;
 }
 
+/*
+ * Bind an inline-cache slot of @tb to @pc.  Returns false if the slot
+ * is already bound to another pc, in which case it must not be linked.
+ */
+static inline bool tb_bind_indirect_jump(TranslationBlock *tb, int n,
+                                         vaddr pc)
+{
+    bool ok;
+
+    if (!(tb->jmp_indirect & (1 << n))) {
+        return true;
+    }
+
+    qemu_thread_jit_write();
+    qemu_spin_lock(&tb->jmp_lock);
+    if (tb->jmp_pc[n] == -1) {
+        tb->jmp_pc[n] = pc;
+    }
+    ok = tb->jmp_pc[n] == pc;
+    qemu_spin_unlock(&tb->jmp_lock);
+    return ok;
+}
+
 static inline bool cpu_handle_halt(CPUState *cpu)
 {
 #ifndef CONFIG_USER_ONLY
@@ -1017,6 +1046,14 @@ cpu_exec_loop(CPUState *cpu, SyncClocks *sc)
                 qatomic_set(&jc->array[h].tb, tb);
             }
 
+            /*
+             * Bind before the page check below: a slot that stays unbound
+             * would send every later miss back here.
+             */
+            if (last_tb && !tb_bind_indirect_jump(last_tb, tb_exit, pc)) {
+                last_tb = NULL;
+            }
+
 #ifndef CONFIG_USER_ONLY
             /*
              * We don't take care of direct jumps when address mapping
@@ -1065,6 +1102,8 @@ int cpu_exec(CPUState *cpu)
         return EXCP_HALTED;
     }
 
+    qatomic_set(&cpu->tcg_exec_count, cpu->tcg_exec_count + 1);
+
     RCU_READ_LOCK_GUARD();
     cpu_exec_enter(cpu);
 
@@ -31,6 +31,7 @@
 #include "exec/mmu-access-type.h"
 #include "exec/tlb-common.h"
 #include "exec/vaddr.h"
+#include "system/dirtylimit.h"
 #include "tcg/tcg.h"
 #include "qemu/error-report.h"
 #include "exec/log.h"
@@ -1234,6 +1235,8 @@ static bool tlb_fill_align(CPUState *cpu, vaddr addr, MMUAccessType type,
     const TCGCPUOps *ops = cpu->cc->tcg_ops;
     CPUTLBEntryFull full;
 
+    qatomic_set(&cpu->neg.tlb.c.fill_count, cpu->neg.tlb.c.fill_count + 1);
+
     if (ops->tlb_fill_align) {
         if (ops->tlb_fill_align(cpu, &full, addr, type, mmu_idx,
                                 memop, size, probe, ra)) {
@@ -1336,6 +1339,22 @@ static void notdirty_write(CPUState *cpu, vaddr mem_vaddr, unsigned size,
         tb_invalidate_phys_range_fast(ram_addr, size, retaddr);
     }
 
+    /*
+     * Account pages dirtied since the last migration bitmap sync to this
+     * vCPU.  Each time it has dirtied the equivalent of a full dirty ring,
+     * queue the dirty limit throttle, if any; the vCPU sleeps outside of
+     * cpu_exec().
+     */
+    if (unlikely(global_dirty_tracking) &&
+        !cpu_physical_memory_get_dirty_flag(ram_addr,
+                                            DIRTY_MEMORY_MIGRATION)) {
+        cpu->dirty_pages++;
+        if (cpu->throttle_us_per_full &&
+            !(cpu->dirty_pages % DIRTYLIMIT_TCG_RING_SIZE)) {
+            dirtylimit_vcpu_ring_full(cpu);
+        }
+    }
+
     /*
      * Set both VGA and migration bits for simplicity and to remove
      * the notdirty callback faster.
@@ -1917,6 +1936,14 @@ static void *atomic_mmu_lookup(CPUState *cpu, vaddr addr, MemOpIdx oi,
  * We don't bother with this widened value for SOFTMMU_CODE_ACCESS.
  */
 
+/*
+ * Hold the BQL for the rest of the scope around an access to @mr,
+ * unless the region dispatches without it.
+ */
+#define MMIO_LOCK_GUARD(mr) \
+    g_autoptr(BQLLockAuto) _bql_lock_auto __attribute__((unused)) \
+        = (mr)->lockless_io ? NULL : bql_auto_lock(__FILE__, __LINE__)
+
 /**
  * do_ld_mmio_beN:
  * @cpu: generic cpu state
@@ -1926,7 +1953,7 @@ static void *atomic_mmu_lookup(CPUState *cpu, vaddr addr, MemOpIdx oi,
  * @size: number of bytes
  * @mmu_idx: virtual address context
  * @ra: return address into tcg generated code, or 0
- * Context: BQL held
+ * Context: BQL held, unless the region has lockless_io
  *
  * Load @size bytes from @addr, which is memory-mapped i/o.
  * The bytes are concatenated in big-endian order with @ret_be.
@@ -1980,7 +2007,7 @@ static uint64_t do_ld_mmio_beN(CPUState *cpu, CPUTLBEntryFull *full,
     section = io_prepare(&mr_offset, cpu, full->xlat_section, attrs, addr, ra);
     mr = section->mr;
 
-    BQL_LOCK_GUARD();
+    MMIO_LOCK_GUARD(mr);
     return int_ld_mmio_beN(cpu, full, ret_be, addr, size, mmu_idx,
                            type, ra, mr, mr_offset);
 }
@@ -2001,7 +2028,7 @@ static Int128 do_ld16_mmio_beN(CPUState *cpu, CPUTLBEntryFull *full,
     section = io_prepare(&mr_offset, cpu, full->xlat_section, attrs, addr, ra);
     mr = section->mr;
 
-    BQL_LOCK_GUARD();
+    MMIO_LOCK_GUARD(mr);
     a = int_ld_mmio_beN(cpu, full, ret_be, addr, size - 8, mmu_idx,
                         MMU_DATA_LOAD, ra, mr, mr_offset);
     b = int_ld_mmio_beN(cpu, full, ret_be, addr + size - 8, 8, mmu_idx,
@@ -2466,7 +2493,7 @@ static Int128 do_ld16_mmu(CPUState *cpu, vaddr addr,
  * @size: number of bytes
  * @mmu_idx: virtual address context
  * @ra: return address into tcg generated code, or 0
- * Context: BQL held
+ * Context: BQL held, unless the region has lockless_io
  *
  * Store @size bytes at @addr, which is memory-mapped i/o.
  * The bytes to store are extracted in little-endian order from @val_le;
@@ -2521,7 +2548,7 @@ static uint64_t do_st_mmio_leN(CPUState *cpu, CPUTLBEntryFull *full,
     section = io_prepare(&mr_offset, cpu, full->xlat_section, attrs, addr, ra);
     mr = section->mr;
 
-    BQL_LOCK_GUARD();
+    MMIO_LOCK_GUARD(mr);
     return int_st_mmio_leN(cpu, full, val_le, addr, size, mmu_idx,
                            ra, mr, mr_offset);
 }
@@ -2541,7 +2568,7 @@ static uint64_t do_st16_mmio_leN(CPUState *cpu, CPUTLBEntryFull *full,
     section = io_prepare(&mr_offset, cpu, full->xlat_section, attrs, addr, ra);
     mr = section->mr;
 
-    BQL_LOCK_GUARD();
+    MMIO_LOCK_GUARD(mr);
     int_st_mmio_leN(cpu, full, int128_getlo(val_le), addr, 8,
                     mmu_idx, ra, mr, mr_offset);
     return int_st_mmio_leN(cpu, full, int128_gethi(val_le), addr + 8,
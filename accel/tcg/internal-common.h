@@ -16,6 +16,9 @@ extern int64_t max_delay;
 extern int64_t max_advance;
 
 extern bool one_insn_per_tb;
+extern bool tb_profile;
+
+void tb_profile_init(const char *filename);
 
 /*
  * Return true if CS is not running in parallel with other cpus, either
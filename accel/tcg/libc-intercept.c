@@ -0,0 +1,164 @@
+/*
+ * Host implementations of hot guest libc routines.
+ *
+ * The guest's memcpy, memset and friends are ordinarily translated
+ * instruction by instruction.  When enabled, the target translator
+ * replaces the entry point of each recognized routine with a call to
+ * libc_intercept_call(), which performs the operation with the host's
+ * (vectorized) libc and returns to the guest caller.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/log.h"
+#include "user/guest-host.h"
+#include "user/page-protection.h"
+#include "exec/page-protection.h"
+#include "user/libc-intercept.h"
+#include "trace.h"
+
+bool libc_intercept_enabled;
+
+static const char * const libc_func_names[] = {
+    [LIBC_FUNC_MEMCPY] = "memcpy",
+    [LIBC_FUNC_MEMMOVE] = "memmove",
+    [LIBC_FUNC_MEMSET] = "memset",
+    [LIBC_FUNC_MEMCMP] = "memcmp",
+    [LIBC_FUNC_STRLEN] = "strlen",
+};
+
+/* Entry point -> LibcFunc, filled before any translation */
+static GHashTable *libc_func_addr;
+
+/*
+ * glibc selects among optimized variants of memcpy and friends with
+ * IFUNCs.  The public symbol is then the resolver, of type
+ * STT_GNU_IFUNC, and the code that actually runs is named after the
+ * routine and the variant, e.g. __memcpy_generic.  Recognize those,
+ * but not the _chk variants, which take an extra argument.
+ */
+static bool libc_name_match(const char *name, const char *func)
+{
+    size_t len = strlen(func);
+
+    if (strcmp(name, func) == 0) {
+        return true;
+    }
+    return strncmp(name, "__", 2) == 0 &&
+           strncmp(name + 2, func, len) == 0 &&
+           name[2 + len] == '_' && name[3 + len] != '\0' &&
+           !g_str_has_prefix(name + 3 + len, "chk");
+}
+
+void libc_intercept_register(const char *name, vaddr addr)
+{
+    if (addr == 0) {
+        return;
+    }
+    for (int i = LIBC_FUNC_NONE + 1; i < ARRAY_SIZE(libc_func_names); i++) {
+        if (libc_name_match(name, libc_func_names[i])) {
+            if (!libc_func_addr) {
+                libc_func_addr = g_hash_table_new_full(g_int64_hash,
+                                                       g_int64_equal,
+                                                       g_free, NULL);
+            }
+            g_hash_table_insert(libc_func_addr, g_memdup2(&addr, sizeof(addr)),
+                                GINT_TO_POINTER(i));
+            qemu_log_mask(CPU_LOG_PAGE, "libc-intercept: %s at 0x%" VADDR_PRIx
+                          "\n", name, addr);
+            return;
+        }
+    }
+}
+
+LibcFunc libc_intercept_lookup(vaddr pc)
+{
+    if (!libc_func_addr) {
+        return LIBC_FUNC_NONE;
+    }
+    return GPOINTER_TO_INT(g_hash_table_lookup(libc_func_addr, &pc));
+}
+
+static bool libc_range_ok(CPUState *cpu, target_ulong addr,
+                          target_ulong len, int flags)
+{
+    return page_check_range(cpu_untagged_addr(cpu, addr), len, flags);
+}
+
+/*
+ * Find the length of the string at @addr a page at a time, so that
+ * we never read beyond the terminating NUL into an unmapped page.
+ */
+static bool libc_strlen(CPUState *cpu, target_ulong addr, target_ulong *ret)
+{
+    target_ulong pos = addr;
+
+    while (true) {
+        target_ulong chunk = TARGET_PAGE_SIZE - (pos & ~TARGET_PAGE_MASK);
+        const char *p, *nul;
+
+        if (!libc_range_ok(cpu, pos, chunk, PAGE_READ)) {
+            return false;
+        }
+        p = g2h(cpu, pos);
+        nul = memchr(p, 0, chunk);
+        if (nul) {
+            *ret = pos - addr + (nul - p);
+            return true;
+        }
+        pos += chunk;
+    }
+}
+
+static bool libc_do_call(CPUState *cpu, LibcFunc func,
+                         const target_ulong *args, target_ulong *ret)
+{
+    target_ulong a0 = args[0], a1 = args[1], len = args[2];
+    int cmp;
+
+    switch (func) {
+    case LIBC_FUNC_MEMCPY:
+    case LIBC_FUNC_MEMMOVE:
+        if (!libc_range_ok(cpu, a1, len, PAGE_READ) ||
+            !libc_range_ok(cpu, a0, len, PAGE_WRITE)) {
+            return false;
+        }
+        /* Overlapping memcpy is undefined; be kind to buggy guests. */
+        memmove(g2h(cpu, a0), g2h(cpu, a1), len);
+        *ret = a0;
+        return true;
+
+    case LIBC_FUNC_MEMSET:
+        if (!libc_range_ok(cpu, a0, len, PAGE_WRITE)) {
+            return false;
+        }
+        memset(g2h(cpu, a0), a1, len);
+        *ret = a0;
+        return true;
+
+    case LIBC_FUNC_MEMCMP:
+        if (!libc_range_ok(cpu, a0, len, PAGE_READ) ||
+            !libc_range_ok(cpu, a1, len, PAGE_READ)) {
+            return false;
+        }
+        cmp = memcmp(g2h(cpu, a0), g2h(cpu, a1), len);
+        *ret = (target_long)(cmp < 0 ? -1 : cmp > 0);
+        return true;
+
+    case LIBC_FUNC_STRLEN:
+        return libc_strlen(cpu, a0, ret);
+
+    default:
+        g_assert_not_reached();
+    }
+}
+
+bool libc_intercept_call(CPUState *cpu, LibcFunc func,
+                         const target_ulong *args, target_ulong *ret)
+{
+    bool done = libc_do_call(cpu, func, args, ret);
+
+    trace_libc_intercept_call(libc_func_names[func], done);
+    return done;
+}
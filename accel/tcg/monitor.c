@@ -8,6 +8,7 @@
 
 #include "qemu/osdep.h"
 #include "qemu/accel.h"
+#include "qemu/error-report.h"
 #include "qemu/qht.h"
 #include "qapi/error.h"
 #include "qapi/type-helpers.h"
@@ -15,6 +16,8 @@
 #include "monitor/monitor.h"
 #include "system/cpus.h"
 #include "system/cpu-timers.h"
+#include "system/stats.h"
+#include "system/system.h"
 #include "system/tcg.h"
 #include "tcg/tcg.h"
 #include "internal-common.h"
@@ -215,6 +218,91 @@ HumanReadableText *qmp_x_query_jit(Error **errp)
     return human_readable_text_from_str(buf);
 }
 
+static gboolean tb_profile_iter(gpointer key, gpointer value, gpointer data)
+{
+    g_ptr_array_add(data, value);
+    return false;
+}
+
+static gint tb_profile_cmp(gconstpointer a, gconstpointer b)
+{
+    const TranslationBlock *tb_a = *(const TranslationBlock **)a;
+    const TranslationBlock *tb_b = *(const TranslationBlock **)b;
+
+    if (tb_a->exec_count != tb_b->exec_count) {
+        return tb_a->exec_count < tb_b->exec_count ? 1 : -1;
+    }
+    return 0;
+}
+
+/* Dump the @max most executed TBs, hottest first */
+static void tb_profile_dump(GString *buf, unsigned max)
+{
+    g_autoptr(GPtrArray) tbs = g_ptr_array_new();
+
+    tcg_tb_foreach(tb_profile_iter, tbs);
+    g_ptr_array_sort(tbs, tb_profile_cmp);
+
+    g_string_append_printf(buf, "%-20s %-18s %-18s %-10s %-10s %5s %5s "
+                           "%6s %5s %5s %5s\n",
+                           "count", "pc", "phys", "flags", "cflags",
+                           "insns", "size", "host", "ops", "calls", "ldst");
+    for (unsigned i = 0; i < tbs->len && i < max; i++) {
+        const TranslationBlock *tb = g_ptr_array_index(tbs, i);
+
+        if (!tb->exec_count) {
+            break;
+        }
+        g_string_append_printf(buf, "%-20" PRIu64 " 0x%016" VADDR_PRIx
+                               " 0x%016" PRIx64 " 0x%08x 0x%08x %5u %5u "
+                               "%6u %5u %5u %5u\n",
+                               tb->exec_count,
+                               tb->cflags & CF_PCREL ? 0 : tb->pc,
+                               (uint64_t)tb->page_addr[0], tb->flags,
+                               tb->cflags, tb->icount, tb->size, tb->tc.size,
+                               tb->prof_ops, tb->prof_calls, tb->prof_ldst);
+    }
+}
+
+HumanReadableText *qmp_x_query_tb_profile(Error **errp)
+{
+    g_autoptr(GString) buf = g_string_new("");
+
+    if (!tcg_enabled()) {
+        error_setg(errp, "TB profile is only available with accel=tcg");
+        return NULL;
+    }
+    if (!tb_profile) {
+        error_setg(errp, "TB profile requires -accel tcg,tb-profile=FILE");
+        return NULL;
+    }
+
+    tb_profile_dump(buf, 32);
+
+    return human_readable_text_from_str(buf);
+}
+
+static char *tb_profile_filename;
+static Notifier tb_profile_exit_notifier;
+
+static void tb_profile_save(Notifier *notifier, void *data)
+{
+    g_autoptr(GString) buf = g_string_new("");
+    g_autoptr(GError) err = NULL;
+
+    tb_profile_dump(buf, UINT_MAX);
+    if (!g_file_set_contents(tb_profile_filename, buf->str, buf->len, &err)) {
+        error_report("tb-profile: %s", err->message);
+    }
+}
+
+void tb_profile_init(const char *filename)
+{
+    tb_profile_filename = g_strdup(filename);
+    tb_profile_exit_notifier.notify = tb_profile_save;
+    qemu_add_exit_notifier(&tb_profile_exit_notifier);
+}
+
 static void tcg_dump_op_count(GString *buf)
 {
     g_string_append_printf(buf, "[TCG profiler not compiled]\n");
@@ -235,10 +323,150 @@ HumanReadableText *qmp_x_query_opcount(Error **errp)
     return human_readable_text_from_str(buf);
 }
 
+typedef struct TCGStatsDesc {
+    const char *name;
+    StatsType type;
+    bool bytes;
+} TCGStatsDesc;
+
+static const TCGStatsDesc tcg_vm_stats[] = {
+    { "code-size", STATS_TYPE_INSTANT, true },
+    { "code-capacity", STATS_TYPE_INSTANT, true },
+    { "tb-flushes", STATS_TYPE_CUMULATIVE },
+    { "tb-invalidations", STATS_TYPE_CUMULATIVE },
+};
+
+static const TCGStatsDesc tcg_vcpu_stats[] = {
+    { "exits", STATS_TYPE_CUMULATIVE },
+    { "translations", STATS_TYPE_CUMULATIVE },
+    { "tlb-fills", STATS_TYPE_CUMULATIVE },
+    { "tlb-full-flushes", STATS_TYPE_CUMULATIVE },
+    { "tlb-partial-flushes", STATS_TYPE_CUMULATIVE },
+    { "tlb-elided-flushes", STATS_TYPE_CUMULATIVE },
+};
+
+static StatsList *tcg_stats_list(const TCGStatsDesc *desc,
+                                 const uint64_t *values, int count,
+                                 strList *names)
+{
+    StatsList *stats_list = NULL;
+
+    for (int i = count - 1; i >= 0; i--) {
+        Stats *stats;
+
+        if (!apply_str_list_filter(desc[i].name, names)) {
+            continue;
+        }
+        stats = g_new0(Stats, 1);
+        stats->name = g_strdup(desc[i].name);
+        stats->value = g_new0(StatsValue, 1);
+        stats->value->type = QTYPE_QNUM;
+        stats->value->u.scalar = values[i];
+        QAPI_LIST_PREPEND(stats_list, stats);
+    }
+    return stats_list;
+}
+
+static void tcg_query_stats_cb(StatsResultList **result, StatsTarget target,
+                               strList *names, strList *targets, Error **errp)
+{
+    CPUState *cpu;
+
+    if (!tcg_enabled()) {
+        return;
+    }
+
+    switch (target) {
+    case STATS_TARGET_VM:
+    {
+        uint64_t values[] = {
+            tcg_code_size(),
+            tcg_code_capacity(),
+            qatomic_read(&tb_ctx.tb_flush_count),
+            qatomic_read(&tb_ctx.tb_phys_invalidate_count),
+        };
+        StatsList *stats_list;
+
+        QEMU_BUILD_BUG_ON(ARRAY_SIZE(values) != ARRAY_SIZE(tcg_vm_stats));
+        stats_list = tcg_stats_list(tcg_vm_stats, values,
+                                    ARRAY_SIZE(values), names);
+        if (stats_list) {
+            add_stats_entry(result, STATS_PROVIDER_TCG, NULL, stats_list);
+        }
+        break;
+    }
+    case STATS_TARGET_VCPU:
+        CPU_FOREACH(cpu) {
+            uint64_t values[] = {
+                qatomic_read(&cpu->tcg_exec_count),
+                qatomic_read(&cpu->tcg_translate_count),
+                qatomic_read(&cpu->neg.tlb.c.fill_count),
+                qatomic_read(&cpu->neg.tlb.c.full_flush_count),
+                qatomic_read(&cpu->neg.tlb.c.part_flush_count),
+                qatomic_read(&cpu->neg.tlb.c.elide_flush_count),
+            };
+            StatsList *stats_list;
+
+            QEMU_BUILD_BUG_ON(ARRAY_SIZE(values) !=
+                              ARRAY_SIZE(tcg_vcpu_stats));
+            if (!apply_str_list_filter(cpu->parent_obj.canonical_path,
+                                       targets)) {
+                continue;
+            }
+            stats_list = tcg_stats_list(tcg_vcpu_stats, values,
+                                        ARRAY_SIZE(values), names);
+            if (stats_list) {
+                add_stats_entry(result, STATS_PROVIDER_TCG,
+                                cpu->parent_obj.canonical_path, stats_list);
+            }
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+static StatsSchemaValueList *tcg_stats_schema(const TCGStatsDesc *desc,
+                                              int count)
+{
+    StatsSchemaValueList *list = NULL;
+
+    for (int i = count - 1; i >= 0; i--) {
+        StatsSchemaValue *value = g_new0(StatsSchemaValue, 1);
+
+        value->name = g_strdup(desc[i].name);
+        value->type = desc[i].type;
+        if (desc[i].bytes) {
+            value->has_unit = true;
+            value->unit = STATS_UNIT_BYTES;
+        }
+        QAPI_LIST_PREPEND(list, value);
+    }
+    return list;
+}
+
+static void tcg_query_stats_schemas_cb(StatsSchemaList **result,
+                                       Error **errp)
+{
+    if (!tcg_enabled()) {
+        return;
+    }
+
+    add_stats_schema(result, STATS_PROVIDER_TCG, STATS_TARGET_VM,
+                     tcg_stats_schema(tcg_vm_stats,
+                                      ARRAY_SIZE(tcg_vm_stats)));
+    add_stats_schema(result, STATS_PROVIDER_TCG, STATS_TARGET_VCPU,
+                     tcg_stats_schema(tcg_vcpu_stats,
+                                      ARRAY_SIZE(tcg_vcpu_stats)));
+}
+
 static void hmp_tcg_register(void)
 {
     monitor_register_hmp_info_hrt("jit", qmp_x_query_jit);
     monitor_register_hmp_info_hrt("opcount", qmp_x_query_opcount);
+    monitor_register_hmp_info_hrt("tb-profile", qmp_x_query_tb_profile);
+    add_stats_callbacks(STATS_PROVIDER_TCG, tcg_query_stats_cb,
+                        tcg_query_stats_schemas_cb);
 }
 
 type_init(hmp_tcg_register);
@@ -873,6 +873,17 @@ static inline void tb_jmp_unlink(TranslationBlock *dest)
         tb_reset_jump(tb, n);
         qatomic_and(&tb->jmp_dest[n], (uintptr_t)NULL | 1);
         /* No need to clear the list entry; setting the dest ptr is enough */
+
+        /*
+         * Free an inline cache slot for another target.  A vCPU that has
+         * already matched the old pc may then take the jump only after it
+         * is linked again to a TB for another pc, but only if the guest
+         * jumps to code that another vCPU is rewriting or unmapping, and
+         * the outcome of that is unpredictable anyway.
+         */
+        if (tb->jmp_indirect & (1 << n)) {
+            tb->jmp_pc[n] = -1;
+        }
     }
     dest->jmp_list_head = (uintptr_t)NULL;
 
@@ -45,6 +45,7 @@ struct TCGState {
 
     bool mttcg_enabled;
     bool one_insn_per_tb;
+    char *tb_profile_file;
     int splitwx_enabled;
     unsigned long tb_size;
 };
@@ -99,6 +100,7 @@ static void tcg_accel_instance_init(Object *obj)
 
 bool mttcg_enabled;
 bool one_insn_per_tb;
+bool tb_profile;
 
 static int tcg_init_machine(MachineState *ms)
 {
@@ -116,6 +118,13 @@ static int tcg_init_machine(MachineState *ms)
     tb_htable_init();
     tcg_init(s->tb_size * MiB, s->splitwx_enabled, max_cpus);
 
+#ifndef CONFIG_USER_ONLY
+    if (s->tb_profile_file) {
+        tb_profile = true;
+        tb_profile_init(s->tb_profile_file);
+    }
+#endif
+
 #if defined(CONFIG_SOFTMMU)
     /*
      * There's no guest base to take into account, so go ahead and
@@ -207,6 +216,20 @@ static void tcg_set_one_insn_per_tb(Object *obj, bool value, Error **errp)
     qatomic_set(&one_insn_per_tb, value);
 }
 
+static char *tcg_get_tb_profile(Object *obj, Error **errp)
+{
+    TCGState *s = TCG_STATE(obj);
+    return g_strdup(s->tb_profile_file);
+}
+
+static void tcg_set_tb_profile(Object *obj, const char *value, Error **errp)
+{
+    TCGState *s = TCG_STATE(obj);
+
+    g_free(s->tb_profile_file);
+    s->tb_profile_file = g_strdup(value);
+}
+
 static int tcg_gdbstub_supported_sstep_flags(void)
 {
     /*
@@ -252,6 +275,12 @@ static void tcg_accel_class_init(ObjectClass *oc, void *data)
                                    tcg_set_one_insn_per_tb);
     object_class_property_set_description(oc, "one-insn-per-tb",
         "Only put one guest insn in each translation block");
+
+    object_class_property_add_str(oc, "tb-profile",
+                                  tcg_get_tb_profile,
+                                  tcg_set_tb_profile);
+    object_class_property_set_description(oc, "tb-profile",
+        "Count translation block executions and save the profile to a file");
 }
 
 static const TypeInfo tcg_accel_type = {
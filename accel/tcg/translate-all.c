@@ -358,6 +358,9 @@ TranslationBlock *tb_gen_code(CPUState *cpu,
 
  restart_translate:
     trace_translate_block(tb, pc, tb->tc.ptr);
+    tb->jmp_indirect = 0;
+    tb->jmp_pc[0] = -1;
+    tb->jmp_pc[1] = -1;
 
     gen_code_size = setjmp_gen_code(env, tb, pc, host_pc, &max_insns, &ti);
     if (unlikely(gen_code_size < 0)) {
@@ -432,6 +435,30 @@ TranslationBlock *tb_gen_code(CPUState *cpu,
     }
     tb->tc.size = gen_code_size;
 
+    if (tb_profile) {
+        TCGOp *op;
+
+        tb->exec_count = 0;
+        tb->prof_ops = tb->prof_calls = tb->prof_ldst = 0;
+        QTAILQ_FOREACH(op, &tcg_ctx->ops, link) {
+            switch (op->opc) {
+            case INDEX_op_insn_start:
+            case INDEX_op_discard:
+            case INDEX_op_set_label:
+                continue;
+            case INDEX_op_call:
+                tb->prof_calls++;
+                break;
+            case INDEX_op_qemu_ld_a32_i32 ... INDEX_op_qemu_st_a64_i128:
+                tb->prof_ldst++;
+                break;
+            default:
+                break;
+            }
+            tb->prof_ops++;
+        }
+    }
+
     /*
      * For CF_PCREL, attribute all executions of the generated code
      * to its first mapping.
@@ -531,6 +558,8 @@ TranslationBlock *tb_gen_code(CPUState *cpu,
         tb_reset_jump(tb, 1);
     }
 
+    qatomic_set(&cpu->tcg_translate_count, cpu->tcg_translate_count + 1);
+
     /*
      * If the TB is not associated with a physical RAM page then it must be
      * a temporary one-insn TB, and we have nothing left to do. Return early
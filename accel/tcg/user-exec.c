@@ -703,6 +703,17 @@ int page_unprotect(tb_page_addr_t address, uintptr_t pc)
     PageFlagsNode *p;
     bool current_tb_invalidated;
 
+    /*
+     * Most write faults that reach here are the guest's own business,
+     * e.g. garbage collectors using mprotect for write barriers.  The
+     * lockless lookup has no false positives, so if it finds a page that
+     * was never writable, report that without serializing on mmap_lock.
+     */
+    p = pageflags_find(address, address);
+    if (p && !(p->flags & PAGE_WRITE_ORG)) {
+        return 0;
+    }
+
     /*
      * Technically this isn't safe inside a signal handler.  However we
      * know this only ever happens in a synchronous SEGV handler, so in
@@ -256,6 +256,21 @@ SRST
     Show dynamic compiler info.
 ERST
 
+#if defined(CONFIG_TCG)
+    {
+        .name       = "tb-profile",
+        .args_type  = "",
+        .params     = "",
+        .help       = "show the most executed translation blocks",
+    },
+#endif
+
+SRST
+  ``info tb-profile``
+    Show the most executed translation blocks. Requires the TCG
+    ``tb-profile`` property.
+ERST
+
 #if defined(CONFIG_TCG)
     {
         .name       = "opcount",
@@ -975,7 +975,7 @@ static QTAILQ_HEAD(, Rom) roms = QTAILQ_HEAD_INITIALIZER(roms);
 
 /*
  * rom->data can be heap-allocated or memory-mapped (e.g. when added with
- * rom_add_elf_program())
+ * rom_add_file() or rom_add_elf_program())
  */
 static void rom_free_data(Rom *rom)
 {
@@ -1082,8 +1082,19 @@ ssize_t rom_add_file(const char *file, const char *fw_dir,
         rom->path = g_strdup(file);
     }
 
-    if (!g_file_get_contents(rom->path, (gchar **) &rom->data,
-                             &size, &gerr)) {
+    /*
+     * Map the file rather than reading it: kernel and initrd images can
+     * be hundreds of MB, and they are only copied into guest memory at
+     * reset.  The mapping is private and writable so that users of
+     * rom_ptr() can still patch the image without touching the file.
+     * Fall back to reading files that cannot be mapped, such as pipes.
+     */
+    rom->mapped_file = g_mapped_file_new(rom->path, TRUE, NULL);
+    if (rom->mapped_file) {
+        rom->data = (uint8_t *)g_mapped_file_get_contents(rom->mapped_file);
+        size = g_mapped_file_get_length(rom->mapped_file);
+    } else if (!g_file_get_contents(rom->path, (gchar **) &rom->data,
+                                    &size, &gerr)) {
         fprintf(stderr, "rom: file %-20s: error %s\n",
                 rom->name, gerr->message);
         goto err;
@@ -26,6 +26,7 @@
 #include "qemu/error-report.h"
 #include "qemu/log.h"
 #include "qemu/module.h"
+#include "qemu/main-loop.h"
 #include "hw/sysbus.h"
 #include "target/riscv/cpu.h"
 #include "hw/qdev-properties.h"
@@ -162,13 +163,21 @@ static uint64_t riscv_aclint_mtimer_read(void *opaque, hwaddr addr,
     return 0;
 }
 
-/* CPU write MTIMER register */
+/*
+ * CPU write MTIMER register
+ *
+ * The region is dispatched without the BQL so that reads of mtime and
+ * mtimecmp do not serialize the harts; writes update timers and raise
+ * interrupts, and still run under the BQL.
+ */
 static void riscv_aclint_mtimer_write(void *opaque, hwaddr addr,
     uint64_t value, unsigned size)
 {
     RISCVAclintMTimerState *mtimer = opaque;
     int i;
 
+    BQL_LOCK_GUARD();
+
     if (addr >= mtimer->timecmp_base &&
         addr < (mtimer->timecmp_base + (mtimer->num_harts << 3))) {
         size_t hartid = mtimer->hartid_base +
@@ -283,6 +292,7 @@ static void riscv_aclint_mtimer_realize(DeviceState *dev, Error **errp)
 
     memory_region_init_io(&s->mmio, OBJECT(dev), &riscv_aclint_mtimer_ops,
                           s, TYPE_RISCV_ACLINT_MTIMER, s->aperture_size);
+    memory_region_enable_lockless_io(&s->mmio);
     sysbus_init_mmio(SYS_BUS_DEVICE(dev), &s->mmio);
 
     s->timer_irqs = g_new(qemu_irq, s->num_harts);
@@ -422,12 +432,14 @@ static uint64_t riscv_aclint_swi_read(void *opaque, hwaddr addr,
     return 0;
 }
 
-/* CPU write [M|S]SWI register */
+/* CPU write [M|S]SWI register, under the BQL as it raises interrupts */
 static void riscv_aclint_swi_write(void *opaque, hwaddr addr, uint64_t value,
         unsigned size)
 {
     RISCVAclintSwiState *swi = opaque;
 
+    BQL_LOCK_GUARD();
+
     if (addr < (swi->num_harts << 2)) {
         size_t hartid = swi->hartid_base + (addr >> 2);
         CPUState *cpu = cpu_by_arch_id(hartid);
@@ -474,6 +486,7 @@ static void riscv_aclint_swi_realize(DeviceState *dev, Error **errp)
 
     memory_region_init_io(&swi->mmio, OBJECT(dev), &riscv_aclint_swi_ops, swi,
                           TYPE_RISCV_ACLINT_SWI, RISCV_ACLINT_SWI_SIZE);
+    memory_region_enable_lockless_io(&swi->mmio);
     sysbus_init_mmio(SYS_BUS_DEVICE(dev), &swi->mmio);
 
     swi->soft_irqs = g_new(qemu_irq, swi->num_harts);
@@ -22,6 +22,7 @@
 #include "qapi/error.h"
 #include "qemu/log.h"
 #include "qemu/module.h"
+#include "qemu/main-loop.h"
 #include "qemu/error-report.h"
 #include "hw/sysbus.h"
 #include "hw/pci/msi.h"
@@ -72,17 +73,28 @@ static void sifive_plic_set_claimed(SiFivePLICState *plic, int irq, bool level)
     atomic_set_masked(&plic->claimed[irq >> 5], 1 << (irq & 31), -!!level);
 }
 
+static bool sifive_plic_enabled(SiFivePLICState *plic, uint32_t addrid,
+                                int irq)
+{
+    uint32_t enable = qatomic_read(&plic->enable[addrid * plic->bitfield_words +
+                                                 (irq >> 5)]);
+
+    return enable & (1 << (irq & 31));
+}
+
 static uint32_t sifive_plic_claimed(SiFivePLICState *plic, uint32_t addrid)
 {
     uint32_t max_irq = 0;
-    uint32_t max_prio = plic->target_priority[addrid];
+    uint32_t max_prio = qatomic_read(&plic->target_priority[addrid]);
     int i, j;
     int num_irq_in_word = 32;
 
     for (i = 0; i < plic->bitfield_words; i++) {
-        uint32_t pending_enabled_not_claimed =
-                        (plic->pending[i] & ~plic->claimed[i]) &
-                            plic->enable[addrid * plic->bitfield_words + i];
+        uint32_t pending = qatomic_read(&plic->pending[i]);
+        uint32_t claimed = qatomic_read(&plic->claimed[i]);
+        uint32_t enable = qatomic_read(&plic->enable[addrid *
+                                                     plic->bitfield_words + i]);
+        uint32_t pending_enabled_not_claimed = pending & ~claimed & enable;
 
         if (!pending_enabled_not_claimed) {
             continue;
@@ -99,7 +111,7 @@ static uint32_t sifive_plic_claimed(SiFivePLICState *plic, uint32_t addrid)
 
         for (j = 0; j < num_irq_in_word; j++) {
             int irq = (i << 5) + j;
-            uint32_t prio = plic->source_priority[irq];
+            uint32_t prio = qatomic_read(&plic->source_priority[irq]);
             int enabled = pending_enabled_not_claimed & (1 << j);
 
             if (enabled && prio > max_prio) {
@@ -112,29 +124,92 @@ static uint32_t sifive_plic_claimed(SiFivePLICState *plic, uint32_t addrid)
     return max_irq;
 }
 
-static void sifive_plic_update(SiFivePLICState *plic)
+/*
+ * Re-evaluate the external interrupt line of a single context.
+ *
+ * The register file is accessed without the BQL, so the line level is
+ * first computed locklessly and compared against the level last driven
+ * onto the hart.  Only a mismatch takes the BQL to drive the line.
+ *
+ * Callers update the register file before calling this.  The full
+ * barrier below orders that update before the read of context_level,
+ * and pairs with the one taken after publishing context_level under
+ * the BQL.  Either the lockless check sees the new context_level and
+ * retries under the BQL, or the BQL holder's recompute sees the update;
+ * the holder loops until its recompute agrees with what it published.
+ */
+static void sifive_plic_update_context(SiFivePLICState *plic, uint32_t addrid)
 {
-    int addrid;
+    uint32_t hartid = plic->addr_config[addrid].hartid;
+    PLICMode mode = plic->addr_config[addrid].mode;
+    bool level;
+    qemu_irq irq;
+
+    switch (mode) {
+    case PLICMode_M:
+        irq = plic->m_external_irqs[hartid - plic->hartid_base];
+        break;
+    case PLICMode_S:
+        irq = plic->s_external_irqs[hartid - plic->hartid_base];
+        break;
+    default:
+        return;
+    }
 
-    /* raise irq on harts where this irq is enabled */
-    for (addrid = 0; addrid < plic->num_addrs; addrid++) {
-        uint32_t hartid = plic->addr_config[addrid].hartid;
-        PLICMode mode = plic->addr_config[addrid].mode;
-        bool level = !!sifive_plic_claimed(plic, addrid);
+    smp_mb();
+    level = !!sifive_plic_claimed(plic, addrid);
+    if (level == qatomic_read(&plic->context_level[addrid])) {
+        return;
+    }
 
-        switch (mode) {
-        case PLICMode_M:
-            qemu_set_irq(plic->m_external_irqs[hartid - plic->hartid_base], level);
-            break;
-        case PLICMode_S:
-            qemu_set_irq(plic->s_external_irqs[hartid - plic->hartid_base], level);
-            break;
-        default:
+    BQL_LOCK_GUARD();
+
+    for (;;) {
+        level = !!sifive_plic_claimed(plic, addrid);
+        if (level == plic->context_level[addrid]) {
             break;
         }
+        qatomic_set(&plic->context_level[addrid], level);
+        smp_mb();
+        qemu_set_irq(irq, level);
     }
 }
 
+/* Re-evaluate the contexts where @irq is enabled */
+static void sifive_plic_update_source(SiFivePLICState *plic, int irq)
+{
+    int addrid;
+
+    for (addrid = 0; addrid < plic->num_addrs; addrid++) {
+        if (sifive_plic_enabled(plic, addrid, irq)) {
+            sifive_plic_update_context(plic, addrid);
+        }
+    }
+}
+
+/*
+ * Claim the highest priority pending interrupt of a context.  Several
+ * harts may claim concurrently: whoever clears the pending bit owns the
+ * interrupt, the others rescan.
+ */
+static uint32_t sifive_plic_claim(SiFivePLICState *plic, uint32_t addrid)
+{
+    uint32_t max_irq, mask;
+
+    do {
+        max_irq = sifive_plic_claimed(plic, addrid);
+        if (!max_irq) {
+            return 0;
+        }
+        mask = 1 << (max_irq & 31);
+    } while (!(atomic_set_masked(&plic->pending[max_irq >> 5], mask, 0) &
+               mask));
+
+    sifive_plic_set_claimed(plic, max_irq, true);
+    sifive_plic_update_source(plic, max_irq);
+    return max_irq;
+}
+
 static uint64_t sifive_plic_read(void *opaque, hwaddr addr, unsigned size)
 {
     SiFivePLICState *plic = opaque;
@@ -142,19 +217,20 @@ static uint64_t sifive_plic_read(void *opaque, hwaddr addr, unsigned size)
     if (addr_between(addr, plic->priority_base, plic->num_sources << 2)) {
         uint32_t irq = (addr - plic->priority_base) >> 2;
 
-        return plic->source_priority[irq];
+        return qatomic_read(&plic->source_priority[irq]);
     } else if (addr_between(addr, plic->pending_base,
                             (plic->num_sources + 31) >> 3)) {
         uint32_t word = (addr - plic->pending_base) >> 2;
 
-        return plic->pending[word];
+        return qatomic_read(&plic->pending[word]);
     } else if (addr_between(addr, plic->enable_base,
                             plic->num_addrs * plic->enable_stride)) {
         uint32_t addrid = (addr - plic->enable_base) / plic->enable_stride;
         uint32_t wordid = (addr & (plic->enable_stride - 1)) >> 2;
 
         if (wordid < plic->bitfield_words) {
-            return plic->enable[addrid * plic->bitfield_words + wordid];
+            return qatomic_read(&plic->enable[addrid * plic->bitfield_words +
+                                              wordid]);
         }
     } else if (addr_between(addr, plic->context_base,
                             plic->num_addrs * plic->context_stride)) {
@@ -162,17 +238,9 @@ static uint64_t sifive_plic_read(void *opaque, hwaddr addr, unsigned size)
         uint32_t contextid = (addr & (plic->context_stride - 1));
 
         if (contextid == 0) {
-            return plic->target_priority[addrid];
+            return qatomic_read(&plic->target_priority[addrid]);
         } else if (contextid == 4) {
-            uint32_t max_irq = sifive_plic_claimed(plic, addrid);
-
-            if (max_irq) {
-                sifive_plic_set_pending(plic, max_irq, false);
-                sifive_plic_set_claimed(plic, max_irq, true);
-            }
-
-            sifive_plic_update(plic);
-            return max_irq;
+            return sifive_plic_claim(plic, addrid);
         }
     }
 
@@ -201,11 +269,12 @@ static void sifive_plic_write(void *opaque, hwaddr addr, uint64_t value,
              * interrupt priority WARL (Write-Any-Read-Legal). Just filter
              * out the access to unsupported priority bits.
              */
-            plic->source_priority[irq] = value % (plic->num_priorities + 1);
-            sifive_plic_update(plic);
+            qatomic_set(&plic->source_priority[irq],
+                        value % (plic->num_priorities + 1));
+            sifive_plic_update_source(plic, irq);
         } else if (value <= plic->num_priorities) {
-            plic->source_priority[irq] = value;
-            sifive_plic_update(plic);
+            qatomic_set(&plic->source_priority[irq], value);
+            sifive_plic_update_source(plic, irq);
         }
     } else if (addr_between(addr, plic->pending_base,
                             (plic->num_sources + 31) >> 3)) {
@@ -218,7 +287,9 @@ static void sifive_plic_write(void *opaque, hwaddr addr, uint64_t value,
         uint32_t wordid = (addr & (plic->enable_stride - 1)) >> 2;
 
         if (wordid < plic->bitfield_words) {
-            plic->enable[addrid * plic->bitfield_words + wordid] = value;
+            qatomic_set(&plic->enable[addrid * plic->bitfield_words + wordid],
+                        value);
+            sifive_plic_update_context(plic, addrid);
         } else {
             qemu_log_mask(LOG_GUEST_ERROR,
                           "%s: Invalid enable write 0x%" HWADDR_PRIx "\n",
@@ -236,17 +307,17 @@ static void sifive_plic_write(void *opaque, hwaddr addr, uint64_t value,
                  * interrupt priority is WARL (Write-Any-Read-Legal). Just
                  * filter out the access to unsupported priority bits.
                  */
-                plic->target_priority[addrid] = value %
-                                                (plic->num_priorities + 1);
-                sifive_plic_update(plic);
+                qatomic_set(&plic->target_priority[addrid],
+                            value % (plic->num_priorities + 1));
+                sifive_plic_update_context(plic, addrid);
             } else if (value <= plic->num_priorities) {
-                plic->target_priority[addrid] = value;
-                sifive_plic_update(plic);
+                qatomic_set(&plic->target_priority[addrid], value);
+                sifive_plic_update_context(plic, addrid);
             }
         } else if (contextid == 4) {
             if (value < plic->num_sources) {
                 sifive_plic_set_claimed(plic, value, false);
-                sifive_plic_update(plic);
+                sifive_plic_update_source(plic, value);
             }
         } else {
             qemu_log_mask(LOG_GUEST_ERROR,
@@ -280,6 +351,7 @@ static void sifive_plic_reset(DeviceState *dev)
     memset(s->pending, 0, sizeof(uint32_t) * s->bitfield_words);
     memset(s->claimed, 0, sizeof(uint32_t) * s->bitfield_words);
     memset(s->enable, 0, sizeof(uint32_t) * s->num_enables);
+    memset(s->context_level, 0, sizeof(bool) * s->num_addrs);
 
     for (i = 0; i < s->num_harts; i++) {
         qemu_set_irq(s->m_external_irqs[i], 0);
@@ -356,7 +428,7 @@ static void sifive_plic_irq_request(void *opaque, int irq, int level)
 
     if (level > 0) {
         sifive_plic_set_pending(s, irq, true);
-        sifive_plic_update(s);
+        sifive_plic_update_source(s, irq);
     }
 }
 
@@ -367,6 +439,7 @@ static void sifive_plic_realize(DeviceState *dev, Error **errp)
 
     memory_region_init_io(&s->mmio, OBJECT(dev), &sifive_plic_ops, s,
                           TYPE_SIFIVE_PLIC, s->aperture_size);
+    memory_region_enable_lockless_io(&s->mmio);
     sysbus_init_mmio(SYS_BUS_DEVICE(dev), &s->mmio);
 
     parse_hart_config(s);
@@ -383,6 +456,7 @@ static void sifive_plic_realize(DeviceState *dev, Error **errp)
     s->pending = g_new0(uint32_t, s->bitfield_words);
     s->claimed = g_new0(uint32_t, s->bitfield_words);
     s->enable = g_new0(uint32_t, s->num_enables);
+    s->context_level = g_new0(bool, s->num_addrs);
 
     qdev_init_gpio_in(dev, sifive_plic_irq_request, s->num_sources);
 
@@ -409,10 +483,23 @@ static void sifive_plic_realize(DeviceState *dev, Error **errp)
     msi_nonbroken = true;
 }
 
+static int sifive_plic_post_load(void *opaque, int version_id)
+{
+    SiFivePLICState *s = opaque;
+    int addrid;
+
+    /* The line levels themselves are migrated as part of the harts' mip */
+    for (addrid = 0; addrid < s->num_addrs; addrid++) {
+        s->context_level[addrid] = !!sifive_plic_claimed(s, addrid);
+    }
+    return 0;
+}
+
 static const VMStateDescription vmstate_sifive_plic = {
     .name = "riscv_sifive_plic",
     .version_id = 1,
     .minimum_version_id = 1,
+    .post_load = sifive_plic_post_load,
     .fields = (const VMStateField[]) {
             VMSTATE_VARRAY_UINT32(source_priority, SiFivePLICState,
                                   num_sources, 0,
@@ -50,6 +50,15 @@ static void sifive_test_write(void *opaque, hwaddr addr,
         case FINISHER_RESET:
             qemu_system_reset_request(SHUTDOWN_CAUSE_GUEST_RESET);
             return;
+        case FINISHER_PAUSE:
+            /*
+             * Marks the end of guest boot: stop here so that the
+             * management layer can save the VM as a boot template.
+             * The guest resumes after the store once it is restarted.
+             */
+            qemu_system_vmstop_request_prepare();
+            qemu_system_vmstop_request(RUN_STATE_PAUSED);
+            return;
         default:
             break;
         }
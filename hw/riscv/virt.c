@@ -19,6 +19,7 @@
  */
 
 #include "qemu/osdep.h"
+#include <libfdt.h>
 #include "qemu/units.h"
 #include "qemu/error-report.h"
 #include "qemu/guest-random.h"
@@ -232,20 +233,22 @@ static void create_fdt_socket_cpus(RISCVVirtState *s, int socket,
                                    char *clust_name, uint32_t *phandle,
                                    uint32_t *intc_phandles)
 {
-    int cpu;
+    int cpu, clust_offset;
     uint32_t cpu_phandle;
     MachineState *ms = MACHINE(s);
     bool is_32_bit = riscv_is_32bit(&s->soc[0]);
     uint8_t satp_mode_max;
+    g_autofree uint32_t *cpu_phandles = g_new(uint32_t,
+                                              s->soc[socket].num_harts);
 
     for (cpu = s->soc[socket].num_harts - 1; cpu >= 0; cpu--) {
         RISCVCPU *cpu_ptr = &s->soc[socket].harts[cpu];
         g_autofree char *cpu_name = NULL;
-        g_autofree char *core_name = NULL;
         g_autofree char *intc_name = NULL;
         g_autofree char *sv_name = NULL;
 
         cpu_phandle = (*phandle)++;
+        cpu_phandles[cpu] = cpu_phandle;
 
         cpu_name = g_strdup_printf("/cpus/cpu@%d",
             s->soc[socket].hartid_base + cpu);
@@ -293,10 +296,31 @@ static void create_fdt_socket_cpus(RISCVVirtState *s, int socket,
             "riscv,cpu-intc");
         qemu_fdt_setprop(ms->fdt, intc_name, "interrupt-controller", NULL, 0);
         qemu_fdt_setprop_cell(ms->fdt, intc_name, "#interrupt-cells", 1);
+    }
+
+    /*
+     * The cluster sits after all the hart nodes in /cpus, so every path
+     * lookup of it walks them.  Look it up once and add the core nodes
+     * by offset, which keeps this linear in the number of harts.
+     */
+    clust_offset = fdt_path_offset(ms->fdt, clust_name);
+    if (clust_offset < 0) {
+        error_report("%s: cannot find %s: %s", __func__, clust_name,
+                     fdt_strerror(clust_offset));
+        exit(1);
+    }
 
-        core_name = g_strdup_printf("%s/core%d", clust_name, cpu);
-        qemu_fdt_add_subnode(ms->fdt, core_name);
-        qemu_fdt_setprop_cell(ms->fdt, core_name, "cpu", cpu_phandle);
+    for (cpu = s->soc[socket].num_harts - 1; cpu >= 0; cpu--) {
+        g_autofree char *core_name = g_strdup_printf("core%d", cpu);
+        int core_offset = fdt_add_subnode(ms->fdt, clust_offset, core_name);
+
+        if (core_offset < 0 ||
+            fdt_setprop_cell(ms->fdt, core_offset, "cpu",
+                             cpu_phandles[cpu]) < 0) {
+            error_report("%s: cannot create %s/%s", __func__, clust_name,
+                         core_name);
+            exit(1);
+        }
     }
 }
 
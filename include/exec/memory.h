@@ -765,6 +765,7 @@ struct MemoryRegion {
     bool nonvolatile;
     bool rom_device;
     bool flush_coalesced_mmio;
+    bool lockless_io;
     bool unmergeable;
     uint8_t dirty_log_mask;
     bool is_iommu;
@@ -2244,6 +2245,21 @@ void memory_region_set_flush_coalesced(MemoryRegion *mr);
  */
 void memory_region_clear_flush_coalesced(MemoryRegion *mr);
 
+/**
+ * memory_region_enable_lockless_io: Dispatch accesses without the BQL.
+ *
+ * MMIO accesses to the region from vCPUs and from address_space_rw() and
+ * friends no longer take the BQL around the MemoryRegionOps callbacks.
+ * The callbacks may then run concurrently on several threads, and must
+ * take care of their own locking; anything that needs the BQL, such as
+ * raising an interrupt line, must take it explicitly (BQL_LOCK_GUARD()
+ * is safe to use whether or not the caller already holds it).  The
+ * re-entrancy guard is disabled for the region as it is not thread-safe.
+ *
+ * @mr: the memory region to be updated.
+ */
+void memory_region_enable_lockless_io(MemoryRegion *mr);
+
 /**
  * memory_region_add_eventfd: Request an eventfd to be triggered when a word
  *                            is written to a location.
@@ -143,6 +143,29 @@ struct TranslationBlock {
     uintptr_t jmp_list_head;
     uintptr_t jmp_list_next[2];
     uintptr_t jmp_dest[2];
+
+    /*
+     * A target may use an outgoing jump as an inline cache for an indirect
+     * branch: the generated code compares the runtime destination against
+     * jmp_pc[n] and only takes goto_tb n on a match.  Such slots are marked
+     * in jmp_indirect and start out with jmp_pc[n] == -1; the first exit
+     * through the slot binds it to the destination pc under jmp_lock.
+     * Unlinking the jump because its destination TB was invalidated sets
+     * jmp_pc[n] back to -1, so that the slot can bind to another pc.
+     */
+    vaddr jmp_pc[2];
+    uint8_t jmp_indirect;
+
+    /*
+     * Execution profile, only maintained with -accel tcg,tb-profile=FILE.
+     * The op counts describe the code after optimization.  exec_count is
+     * incremented by the generated code itself, non-atomically, so it may
+     * undercount under MTTCG.
+     */
+    uint16_t prof_ops;
+    uint16_t prof_calls;
+    uint16_t prof_ldst;
+    uint64_t exec_count;
 };
 
 /* The alignment given to TranslationBlock during allocation. */
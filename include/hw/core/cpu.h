@@ -310,6 +310,7 @@ typedef struct CPUTLBCommon {
     size_t full_flush_count;
     size_t part_flush_count;
     size_t elide_flush_count;
+    size_t fill_count;
 } CPUTLBCommon;
 
 /*
@@ -507,6 +508,12 @@ struct CPUState {
     MemoryRegion *memory;
 
     struct CPUJumpCache *tb_jmp_cache;
+    /*
+     * TCG statistics, only written by the vCPU thread and read
+     * atomically by the monitor.
+     */
+    size_t tcg_exec_count;
+    size_t tcg_translate_count;
 
     GArray *gdb_regs;
     int gdb_num_regs;
@@ -532,7 +539,6 @@ struct CPUState {
     struct kvm_run *kvm_run;
     struct kvm_dirty_gfn *kvm_dirty_gfns;
     uint32_t kvm_fetch_index;
-    uint64_t dirty_pages;
     int kvm_vcpu_stats_fd;
     bool vcpu_dirty;
 
@@ -557,6 +563,13 @@ struct CPUState {
      */
     bool throttle_thread_scheduled;
 
+    /*
+     * Pages dirtied by this vCPU, for dirty page rate measurement: reaped
+     * from the dirty ring with KVM, counted in the notdirty slow path
+     * with TCG.
+     */
+    uint64_t dirty_pages;
+
     /*
      * Sleep throttle_us_per_full microseconds once dirty ring is full
      * if dirty page rate limit is enabled.
@@ -58,6 +58,8 @@ struct SiFivePLICState {
     uint32_t *pending;
     uint32_t *claimed;
     uint32_t *enable;
+    /* level last driven on each context's external interrupt line */
+    bool *context_level;
 
     /* config */
     char *hart_config;
@@ -39,7 +39,8 @@ struct SiFiveTestState {
 enum {
     FINISHER_FAIL = 0x3333,
     FINISHER_PASS = 0x5555,
-    FINISHER_RESET = 0x7777
+    FINISHER_RESET = 0x7777,
+    FINISHER_PAUSE = 0x9999
 };
 
 DeviceState *sifive_test_create(hwaddr addr);
@@ -13,6 +13,13 @@
 #define QEMU_DIRTYRLIMIT_H
 
 #define DIRTYLIMIT_CALC_TIME_MS         1000    /* 1000ms */
+/*
+ * TCG has no dirty ring: a throttled vCPU sleeps each time it has dirtied
+ * this many pages, as if a ring of this size had filled up.
+ */
+#define DIRTYLIMIT_TCG_RING_SIZE        4096    /* pages */
+
+bool dirtylimit_supported(void);
 
 int64_t vcpu_dirty_rate_get(int cpu_index);
 void vcpu_dirty_rate_stat_start(void);
@@ -34,6 +41,7 @@ void dirtylimit_set_vcpu(int cpu_index,
 void dirtylimit_set_all(uint64_t quota,
                         bool enable);
 void dirtylimit_vcpu_execute(CPUState *cpu);
+void dirtylimit_vcpu_ring_full(CPUState *cpu);
 uint64_t dirtylimit_throttle_time_per_round(void);
 uint64_t dirtylimit_ring_full_time(void);
 #endif
@@ -50,6 +50,8 @@ typedef struct ReplayNetState ReplayNetState;
 
 /* Name of the initial VM snapshot */
 extern char *replay_snapshot;
+/* Instructions between automatic snapshots while replaying, or 0 */
+extern uint64_t replay_snapshot_period;
 
 /* Replay locking
  *
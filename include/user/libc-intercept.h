@@ -0,0 +1,63 @@
+/*
+ * Host implementations of hot guest libc routines.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+#ifndef USER_LIBC_INTERCEPT_H
+#define USER_LIBC_INTERCEPT_H
+
+#ifndef CONFIG_USER_ONLY
+#error Cannot include this header from system emulation
+#endif
+
+#include "exec/target_long.h"
+#include "exec/vaddr.h"
+
+typedef enum LibcFunc {
+    LIBC_FUNC_NONE,
+    LIBC_FUNC_MEMCPY,
+    LIBC_FUNC_MEMMOVE,
+    LIBC_FUNC_MEMSET,
+    LIBC_FUNC_MEMCMP,
+    LIBC_FUNC_STRLEN,
+} LibcFunc;
+
+/* Set from the command line; nothing is registered unless true. */
+extern bool libc_intercept_enabled;
+
+/**
+ * libc_intercept_register:
+ * @name: symbol name from the guest image
+ * @addr: guest address of the symbol
+ *
+ * Record @addr as the entry point of a recognized libc routine, or of
+ * one of the variants that glibc selects for it with an IFUNC.
+ * Unrecognized names are ignored.  Called while loading the image,
+ * before any code is translated.
+ */
+void libc_intercept_register(const char *name, vaddr addr);
+
+/**
+ * libc_intercept_lookup:
+ * @pc: guest address about to be translated
+ *
+ * Return the routine whose entry point is @pc, or LIBC_FUNC_NONE.
+ */
+LibcFunc libc_intercept_lookup(vaddr pc);
+
+/**
+ * libc_intercept_call:
+ * @cpu: the cpu context
+ * @func: routine to perform
+ * @args: the first three integer arguments, in ABI order
+ * @ret: the return value, on success
+ *
+ * Perform @func with the host libc, directly on guest memory.
+ * Return false, without side effects, if any of the memory is not
+ * mapped with the required permissions; the caller should then run
+ * the guest's own implementation, which will fault normally.
+ */
+bool libc_intercept_call(CPUState *cpu, LibcFunc func,
+                         const target_ulong *args, target_ulong *ret);
+
+#endif /* USER_LIBC_INTERCEPT_H */
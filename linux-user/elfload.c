@@ -9,6 +9,7 @@
 #include "qemu.h"
 #include "user/tswap-target.h"
 #include "user/page-protection.h"
+#include "user/libc-intercept.h"
 #include "exec/page-protection.h"
 #include "exec/translation-block.h"
 #include "user/guest-base.h"
@@ -3495,7 +3496,7 @@ static void load_elf_image(const char *image_name, const ImageSource *src,
         info->end_data = info->end_code;
     }
 
-    if (qemu_log_enabled()) {
+    if (qemu_log_enabled() || libc_intercept_enabled) {
         load_symbols(ehdr, src, load_bias);
     }
 
@@ -3634,9 +3635,12 @@ static int symcmp(const void *s0, const void *s1)
         : ((sym0->st_value > sym1->st_value) ? 1 : 0);
 }
 
-/* Best attempt to load symbols from this ELF object. */
-static void load_symbols(struct elfhdr *hdr, const ImageSource *src,
-                         abi_ulong load_bias)
+/*
+ * Best attempt to load symbols from this ELF object into @s.
+ * Returns false, leaving @s empty, if there were none to load.
+ */
+static bool load_symbols_into(struct syminfo *s, struct elfhdr *hdr,
+                              const ImageSource *src, abi_ulong load_bias)
 {
     int i, shnum, nsyms, sym_idx = 0, str_idx = 0;
     g_autofree struct elf_shdr *shdr = NULL;
@@ -3649,7 +3653,7 @@ static void load_symbols(struct elfhdr *hdr, const ImageSource *src,
     shdr = imgsrc_read_alloc(hdr->e_shoff, shnum * sizeof(struct elf_shdr),
                              src, NULL);
     if (shdr == NULL) {
-        return;
+        return false;
     }
 
     bswap_shdr(shdr, shnum);
@@ -3662,7 +3666,7 @@ static void load_symbols(struct elfhdr *hdr, const ImageSource *src,
     }
 
     /* There will be no symbol table if the file was stripped.  */
-    return;
+    return false;
 
  found:
     /* Now know where the strtab and symtab are.  Snarf them.  */
@@ -3731,25 +3735,138 @@ static void load_symbols(struct elfhdr *hdr, const ImageSource *src,
 
     qsort(syms, nsyms, sizeof(*syms), symcmp);
 
-    {
-        struct syminfo *s = g_new(struct syminfo, 1);
-
-        s->disas_strtab = strings;
-        s->disas_num_syms = nsyms;
+    s->disas_strtab = strings;
+    s->disas_num_syms = nsyms;
 #if ELF_CLASS == ELFCLASS32
-        s->disas_symtab.elf32 = syms;
+    s->disas_symtab.elf32 = syms;
 #else
-        s->disas_symtab.elf64 = syms;
+    s->disas_symtab.elf64 = syms;
 #endif
-        s->lookup_symbol = lookup_symbolxx;
-        s->next = syminfos;
-        syminfos = s;
-    }
-    return;
+    return true;
 
  give_up:
     g_free(strings);
     g_free(syms);
+    return false;
+}
+
+/*
+ * Reading, swapping and sorting the symbol table of a large static
+ * binary can take a noticeable amount of time, and it is only needed
+ * once something asks for a symbol name.  Do the work on a separate
+ * thread, reading from a private dup of the image file descriptor,
+ * and make lookups wait for it to complete.
+ */
+typedef struct SymLoadJob {
+    struct syminfo s;
+    struct elfhdr hdr;
+    ImageSource src;
+    abi_ulong load_bias;
+    QemuThread thread;
+    QemuEvent done;
+    bool empty;
+} SymLoadJob;
+
+static void *load_symbols_thread(void *opaque)
+{
+    SymLoadJob *job = opaque;
+
+    /*
+     * The job is already linked into syminfos, so it cannot simply be
+     * dropped when there is no symbol table; mark it for lookups to skip.
+     */
+    job->empty = !load_symbols_into(&job->s, &job->hdr, &job->src,
+                                    job->load_bias);
+    close(job->src.fd);
+    qemu_event_set(&job->done);
+    return NULL;
+}
+
+static const char *lookup_symbol_async(struct syminfo *s, uint64_t orig_addr)
+{
+    SymLoadJob *job = container_of(s, SymLoadJob, s);
+
+    qemu_event_wait(&job->done);
+    if (job->empty) {
+        return "";
+    }
+    return lookup_symbolxx(s, orig_addr);
+}
+
+static void register_libc_symbols(struct syminfo *s)
+{
+#if ELF_CLASS == ELFCLASS32
+    struct elf_sym *syms = s->disas_symtab.elf32;
+#else
+    struct elf_sym *syms = s->disas_symtab.elf64;
+#endif
+
+    /*
+     * Only STT_FUNC symbols are kept, so e.g. an ifunc resolver is
+     * never mistaken for the routine itself.
+     */
+    for (unsigned i = 0; i < s->disas_num_syms; i++) {
+        int bind = ELF_ST_BIND(syms[i].st_info);
+
+        if (bind == STB_GLOBAL || bind == STB_WEAK) {
+            libc_intercept_register(s->disas_strtab + syms[i].st_name,
+                                    syms[i].st_value);
+        }
+    }
+}
+
+static void load_symbols(struct elfhdr *hdr, const ImageSource *src,
+                         abi_ulong load_bias)
+{
+    struct syminfo *s;
+    int fd = -1;
+
+    /*
+     * The vdso image has no file descriptor, and a small symbol table;
+     * there is no point in deferring that.  Intercepted libc entry
+     * points must be known before the first translation.
+     */
+    if (src->fd >= 0 && !libc_intercept_enabled) {
+        fd = dup(src->fd);
+    }
+
+    if (fd >= 0) {
+        SymLoadJob *job = g_new0(SymLoadJob, 1);
+
+        job->hdr = *hdr;
+        job->src.fd = fd;
+        job->load_bias = load_bias;
+        qemu_event_init(&job->done, false);
+
+        s = &job->s;
+        s->lookup_symbol = lookup_symbol_async;
+        qemu_thread_create(&job->thread, "elf-symbols", load_symbols_thread,
+                           job, QEMU_THREAD_DETACHED);
+    } else {
+        s = g_new0(struct syminfo, 1);
+        s->lookup_symbol = lookup_symbolxx;
+        if (!load_symbols_into(s, hdr, src, load_bias)) {
+            g_free(s);
+            return;
+        }
+        if (libc_intercept_enabled) {
+            register_libc_symbols(s);
+        }
+    }
+
+    s->next = syminfos;
+    syminfos = s;
+}
+
+void load_symbols_wait(void)
+{
+    struct syminfo *s;
+
+    for (s = syminfos; s; s = s->next) {
+        if (s->lookup_symbol == lookup_symbol_async) {
+            qemu_event_wait(&container_of(s, SymLoadJob, s)->done);
+        }
+    }
 }
 
 uint32_t get_elf_eflags(int fd)
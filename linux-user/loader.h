@@ -93,6 +93,14 @@ uint32_t get_elf_eflags(int fd);
 int load_elf_binary(struct linux_binprm *bprm, struct image_info *info);
 int load_flt_binary(struct linux_binprm *bprm, struct image_info *info);
 
+/**
+ * load_symbols_wait: Wait for background symbol table loading
+ *
+ * Symbol tables for logging are loaded on a separate thread.  Block
+ * until that has finished, e.g. before fork() discards the thread.
+ */
+void load_symbols_wait(void);
+
 abi_long memcpy_to_target(abi_ulong dest, const void *src,
                           unsigned long len);
 
@@ -40,6 +40,7 @@
 #include "qemu/plugin.h"
 #include "user/guest-base.h"
 #include "user/page-protection.h"
+#include "user/libc-intercept.h"
 #include "exec/exec-all.h"
 #include "exec/gdbstub.h"
 #include "gdbstub/user.h"
@@ -143,6 +144,7 @@ unsigned long guest_stack_size = TARGET_DEFAULT_STACK_SIZE;
 /* Make sure everything is in a consistent state for calling fork().  */
 void fork_start(void)
 {
+    load_symbols_wait();
     start_exclusive();
     mmap_fork_start();
     cpu_list_lock();
@@ -425,6 +427,11 @@ static void handle_arg_one_insn_per_tb(const char *arg)
     opt_one_insn_per_tb = true;
 }
 
+static void handle_arg_libc_intercept(const char *arg)
+{
+    libc_intercept_enabled = true;
+}
+
 static void handle_arg_strace(const char *arg)
 {
     enable_strace = true;
@@ -517,6 +524,9 @@ static const struct qemu_argument arg_table[] = {
     {"one-insn-per-tb",
                    "QEMU_ONE_INSN_PER_TB",  false, handle_arg_one_insn_per_tb,
      "",           "run with one guest instruction per emulated TB"},
+    {"libc-intercept",
+                   "QEMU_LIBC_INTERCEPT", false, handle_arg_libc_intercept,
+     "",           "run guest memcpy/memmove/memset/memcmp/strlen with host libc"},
     {"strace",     "QEMU_STRACE",      false, handle_arg_strace,
      "",           "log system calls"},
     {"seed",       "QEMU_RAND_SEED",   true,  handle_arg_seed,
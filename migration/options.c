@@ -28,7 +28,7 @@
 #include "qemu-file.h"
 #include "ram.h"
 #include "options.h"
-#include "system/kvm.h"
+#include "system/dirtylimit.h"
 
 /* Maximum migrate downtime set to 2000 seconds */
 #define MAX_MIGRATE_DOWNTIME_SECONDS 2000
@@ -571,9 +571,10 @@ bool migrate_caps_check(bool *old_caps, bool *new_caps, Error **errp)
             return false;
         }
 
-        if (!kvm_enabled() || !kvm_dirty_ring_enabled()) {
-            error_setg(errp, "dirty-limit requires KVM with accelerator"
-                   " property 'dirty-ring-size' set");
+        if (!dirtylimit_supported()) {
+            error_setg(errp, "dirty-limit requires multi-threaded TCG, or"
+                       " KVM with accelerator property 'dirty-ring-size'"
+                       " set");
             return false;
         }
     }
@@ -19,12 +19,14 @@
 #include "qapi/qapi-commands-replay.h"
 #include "qapi/qmp/qdict.h"
 #include "qemu/timer.h"
+#include "qemu/error-report.h"
 #include "block/snapshot.h"
 #include "migration/snapshot.h"
 
 static bool replay_is_debugging;
 static int64_t replay_last_breakpoint;
 static int64_t replay_last_snapshot;
+static uint64_t replay_last_checkpoint;
 
 bool replay_running_debug(void)
 {
@@ -314,6 +316,48 @@ void replay_breakpoint(void)
     replay_last_breakpoint = replay_get_current_icount();
 }
 
+/*
+ * Snapshots are taken from the main loop on the first opportunity after
+ * the period has elapsed.  After a seek backwards the next one is still
+ * due a period after the furthest point replayed, so that replaying
+ * the same stretch again does not take new snapshots.
+ */
+static void replay_take_checkpoint(void *opaque)
+{
+    uint64_t icount = replay_get_current_icount();
+    g_autofree char *name = g_strdup_printf("replay_%" PRIu64, icount);
+    Error *err = NULL;
+
+    if (icount < replay_last_checkpoint + replay_snapshot_period) {
+        replay_checkpoint_icount = replay_last_checkpoint
+                                   + replay_snapshot_period;
+        return;
+    }
+    if (!replay_can_snapshot()) {
+        /* Events are in flight, try again when execution moves on. */
+        replay_checkpoint_icount = icount + 1;
+        return;
+    }
+    if (!save_snapshot(name, true, NULL, false, NULL, &err)) {
+        /* Stop trying, e.g. when no drive can hold VM snapshots. */
+        warn_report_err(err);
+        return;
+    }
+    replay_last_checkpoint = icount;
+    replay_checkpoint_icount = icount + replay_snapshot_period;
+}
+
+void replay_checkpoint_init(void)
+{
+    assert(replay_mode == REPLAY_MODE_PLAY);
+    assert(replay_snapshot_period);
+
+    replay_checkpoint_timer = timer_new_ns(QEMU_CLOCK_REALTIME,
+                                           replay_take_checkpoint, NULL);
+    replay_checkpoint_icount = replay_get_current_icount()
+                               + replay_snapshot_period;
+}
+
 void replay_gdb_attached(void)
 {
     /*
@@ -15,6 +15,7 @@
 #include "replay-internal.h"
 #include "qemu/error-report.h"
 #include "qemu/main-loop.h"
+#include "qemu/bswap.h"
 
 /* Mutex to protect reading and writing events to the log.
    data_kind and has_unread_data are also protected
@@ -44,6 +45,19 @@ static void replay_read_error(void)
     exit(1);
 }
 
+/*
+ * Multi-byte values are written and read with a single stdio call each,
+ * rather than one locked putc()/getc() per byte.
+ */
+static void replay_put_bytes(const uint8_t *buf, size_t size)
+{
+    if (replay_file) {
+        if (fwrite(buf, 1, size, replay_file) != size) {
+            replay_write_error();
+        }
+    }
+}
+
 void replay_put_byte(uint8_t byte)
 {
     if (replay_file) {
@@ -62,20 +76,26 @@ void replay_put_event(uint8_t event)
 
 void replay_put_word(uint16_t word)
 {
-    replay_put_byte(word >> 8);
-    replay_put_byte(word);
+    uint8_t buf[2];
+
+    stw_be_p(buf, word);
+    replay_put_bytes(buf, sizeof(buf));
 }
 
 void replay_put_dword(uint32_t dword)
 {
-    replay_put_word(dword >> 16);
-    replay_put_word(dword);
+    uint8_t buf[4];
+
+    stl_be_p(buf, dword);
+    replay_put_bytes(buf, sizeof(buf));
 }
 
 void replay_put_qword(int64_t qword)
 {
-    replay_put_dword(qword >> 32);
-    replay_put_dword(qword);
+    uint8_t buf[8];
+
+    stq_be_p(buf, qword);
+    replay_put_bytes(buf, sizeof(buf));
 }
 
 void replay_put_array(const uint8_t *buf, size_t size)
@@ -88,6 +108,13 @@ void replay_put_array(const uint8_t *buf, size_t size)
     }
 }
 
+static void replay_get_bytes(uint8_t *buf, size_t size)
+{
+    if (fread(buf, 1, size, replay_file) != size) {
+        replay_read_error();
+    }
+}
+
 uint8_t replay_get_byte(void)
 {
     uint8_t byte = 0;
@@ -103,35 +130,35 @@ uint8_t replay_get_byte(void)
 
 uint16_t replay_get_word(void)
 {
-    uint16_t word = 0;
-    if (replay_file) {
-        word = replay_get_byte();
-        word = (word << 8) + replay_get_byte();
-    }
+    uint8_t buf[2];
 
-    return word;
+    if (!replay_file) {
+        return 0;
+    }
+    replay_get_bytes(buf, sizeof(buf));
+    return lduw_be_p(buf);
 }
 
 uint32_t replay_get_dword(void)
 {
-    uint32_t dword = 0;
-    if (replay_file) {
-        dword = replay_get_word();
-        dword = (dword << 16) + replay_get_word();
-    }
+    uint8_t buf[4];
 
-    return dword;
+    if (!replay_file) {
+        return 0;
+    }
+    replay_get_bytes(buf, sizeof(buf));
+    return ldl_be_p(buf);
 }
 
 int64_t replay_get_qword(void)
 {
-    int64_t qword = 0;
-    if (replay_file) {
-        qword = replay_get_dword();
-        qword = (qword << 32) + replay_get_dword();
-    }
+    uint8_t buf[8];
 
-    return qword;
+    if (!replay_file) {
+        return 0;
+    }
+    replay_get_bytes(buf, sizeof(buf));
+    return ldq_be_p(buf);
 }
 
 void replay_get_array(uint8_t *buf, size_t *size)
@@ -267,6 +294,12 @@ void replay_advance_current_icount(uint64_t current_icount)
                 qemu_notify_event();
             }
         }
+        /* Execution passed the next automatic snapshot point */
+        if (replay_checkpoint_icount <= replay_state.current_icount) {
+            replay_checkpoint_icount = -1ULL;
+            timer_mod_ns(replay_checkpoint_timer,
+                qemu_clock_get_ns(QEMU_CLOCK_REALTIME));
+        }
         /* Execution reached the break step */
         if (replay_break_icount == replay_state.current_icount) {
             /* Cannot make callback directly from the vCPU thread */
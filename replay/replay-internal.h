@@ -105,6 +105,10 @@ extern FILE *replay_file;
 extern uint64_t replay_break_icount;
 /* Timer for the replay breakpoint callback */
 extern QEMUTimer *replay_break_timer;
+/* Instruction count of the next automatic snapshot while replaying */
+extern uint64_t replay_checkpoint_icount;
+/* Timer for taking the automatic snapshot */
+extern QEMUTimer *replay_checkpoint_timer;
 
 void replay_put_byte(uint8_t byte);
 void replay_put_event(uint8_t event);
@@ -212,4 +216,10 @@ G_NORETURN void replay_sync_error(const char *error);
    to make cached timers available for post_load functions. */
 void replay_vmstate_register(void);
 
+/* Reverse debugging */
+
+/*! Starts taking a VM snapshot every replay_snapshot_period instructions
+    while replaying, so that seeking back only replays a short stretch. */
+void replay_checkpoint_init(void);
+
 #endif
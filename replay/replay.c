@@ -17,6 +17,7 @@
 #include "replay-internal.h"
 #include "qemu/main-loop.h"
 #include "qemu/option.h"
+#include "qemu/units.h"
 #include "system/cpus.h"
 #include "qemu/error-report.h"
 
@@ -25,9 +26,12 @@
 #define REPLAY_VERSION              0xe0200c
 /* Size of replay log header */
 #define HEADER_SIZE                 (sizeof(uint32_t) + sizeof(uint64_t))
+/* Size of the stdio buffer for the replay log */
+#define REPLAY_FILE_BUF_SIZE        (1 * MiB)
 
 ReplayMode replay_mode = REPLAY_MODE_NONE;
 char *replay_snapshot;
+uint64_t replay_snapshot_period;
 
 /* Name of replay file  */
 static char *replay_filename;
@@ -38,6 +42,10 @@ static GSList *replay_blockers;
 uint64_t replay_break_icount = -1ULL;
 QEMUTimer *replay_break_timer;
 
+/* Periodic replay checkpoints */
+uint64_t replay_checkpoint_icount = -1ULL;
+QEMUTimer *replay_checkpoint_timer;
+
 /* Pretty print event names */
 
 static const char *replay_async_event_name(ReplayAsyncEventKind event)
@@ -360,6 +368,7 @@ static void replay_enable(const char *fname, int mode)
         fprintf(stderr, "Replay: open %s: %s\n", fname, strerror(errno));
         exit(1);
     }
+    setvbuf(replay_file, NULL, _IOFBF, REPLAY_FILE_BUF_SIZE);
 
     replay_filename = g_strdup(fname);
     replay_mode = mode;
@@ -424,6 +433,7 @@ void replay_configure(QemuOpts *opts)
     }
 
     replay_snapshot = g_strdup(qemu_opt_get(opts, "rrsnapshot"));
+    replay_snapshot_period = qemu_opt_get_number(opts, "rrperiod", 0);
     replay_vmstate_register();
     replay_enable(fname, mode);
 
@@ -446,7 +456,9 @@ void replay_start(void)
         exit(1);
     }
 
-    /* Timer for snapshotting will be set up here. */
+    if (replay_mode == REPLAY_MODE_PLAY && replay_snapshot_period) {
+        replay_checkpoint_init();
+    }
 
     replay_enable_events();
 }
@@ -36,6 +36,7 @@
 allpatterns = []
 anyextern = False
 testforerror = False
+decode_table = False
 
 translate_prefix = 'trans'
 translate_scope = 'static '
@@ -1493,6 +1494,68 @@ def prop_size(tree):
 # end prop_size
 
 
+def output_union(ind):
+    output(ind, 'union {\n')
+    for n in sorted(arguments.keys()):
+        f = arguments[n]
+        output(ind, str_indent(4), f.struct_name(), ' f_', f.name, ';\n')
+    output(ind, '} u;\n\n')
+
+
+def table_ok(t):
+    """Return true if decode tree node T can be dispatched by table"""
+    if not isinstance(t, Tree):
+        return False
+    sh = is_contiguous(t.thismask)
+    return sh >= 0 and (t.thismask >> sh) < 4096
+
+
+def str_table_entry(t, name):
+    sh = is_contiguous(t.thismask)
+    return f'{name}_table[(insn >> {sh}) & {t.thismask >> sh:#x}]'
+
+
+def output_table_dispatch(ind, t, name):
+    output(ind, 'bool (*fn)(DisasContext *, ', insntype, ') = ',
+           str_table_entry(t, name), ';\n')
+    output(ind, 'return fn && fn(ctx, insn);\n')
+
+
+def output_table(t, name, levels, outerbits, outermask):
+    """Output the children of decode tree node T as separate functions,
+       and a table NAME_table indexed by the bits of T.thismask.  Up to
+       LEVELS levels of the tree are decoded by table lookup."""
+    sh = is_contiguous(t.thismask)
+    innermask = outermask | t.thismask
+    entries = []
+
+    for b, s in sorted(t.subs):
+        sub = f'{name}_{b >> sh:x}'
+        innerbits = outerbits | b
+        if levels > 1 and table_ok(s):
+            output_table(s, sub, levels - 1, innerbits, innermask)
+            output('static bool ', sub, '(DisasContext *ctx, ',
+                   insntype, ' insn)\n{\n')
+            output_table_dispatch(str_indent(4), s, sub)
+        else:
+            output('static bool ', sub, '(DisasContext *ctx, ',
+                   insntype, ' insn)\n{\n')
+            output_union(str_indent(4))
+            output(str_indent(4), '/* ',
+                   str_match_bits(innerbits, innermask), ' */\n')
+            s.output_code(4, False, innerbits, innermask)
+            output(str_indent(4), 'return false;\n')
+        output('}\n\n')
+        entries.append((b >> sh, sub))
+
+    output('static bool (* const ', name, '_table[',
+           str((t.thismask >> sh) + 1), '])(DisasContext *, ',
+           insntype, ') = {\n')
+    for (i, sub) in entries:
+        output(str_indent(4), f'[{i:#x}] = {sub},\n')
+    output('};\n\n')
+
+
 def main():
     global arguments
     global formats
@@ -1511,12 +1574,13 @@ def main():
     global variablewidth
     global anyextern
     global testforerror
+    global decode_table
 
     decode_scope = 'static '
 
     long_opts = ['decode=', 'translate=', 'output=', 'insnwidth=',
                  'static-decode=', 'varinsnwidth=', 'test-for-error',
-                 'output-null']
+                 'output-null', 'table']
     try:
         (opts, args) = getopt.gnu_getopt(sys.argv[1:], 'o:vw:', long_opts)
     except getopt.GetoptError as err:
@@ -1549,6 +1613,8 @@ def main():
             testforerror = True
         elif o == '--output-null':
             output_null = True
+        elif o == '--table':
+            decode_table = True
         else:
             assert False, 'unhandled option'
 
@@ -1624,20 +1690,25 @@ def main():
         f = formats[n]
         f.output_extract()
 
+    # With --table, the first two levels of the decode tree become
+    # indexed lookups instead of nested switch statements.
+    use_table = (decode_table and not variablewidth
+                 and len(allpatterns) != 0 and table_ok(toppat.tree))
+    if use_table:
+        output_table(toppat.tree, decode_function, 2, 0, 0)
+
     output(decode_scope, 'bool ', decode_function,
            '(DisasContext *ctx, ', insntype, ' insn)\n{\n')
 
     i4 = str_indent(4)
 
-    if len(allpatterns) != 0:
-        output(i4, 'union {\n')
-        for n in sorted(arguments.keys()):
-            f = arguments[n]
-            output(i4, i4, f.struct_name(), ' f_', f.name, ';\n')
-        output(i4, '} u;\n\n')
-        toppat.output_code(4, False, 0, 0)
-
-    output(i4, 'return false;\n')
+    if use_table:
+        output_table_dispatch(i4, toppat.tree, decode_function)
+    else:
+        if len(allpatterns) != 0:
+            output_union(i4)
+            toppat.output_code(4, False, 0, 0)
+        output(i4, 'return false;\n')
     output('}\n')
 
     if variablewidth:
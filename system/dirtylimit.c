@@ -23,6 +23,7 @@
 #include "exec/target_page.h"
 #include "hw/boards.h"
 #include "system/kvm.h"
+#include "system/tcg.h"
 #include "trace.h"
 #include "migration/misc.h"
 
@@ -238,12 +239,26 @@ bool dirtylimit_vcpu_index_valid(int cpu_index)
              cpu_index >= ms->smp.max_cpus);
 }
 
+/*
+ * With TCG, pages are only counted the first time they are written after
+ * a migration bitmap sync, so the dirty page rate can only be measured,
+ * and limited, while a migration is running.  Round-robin TCG runs every
+ * vCPU on one thread, where a per-vCPU sleep would stop them all.
+ */
+bool dirtylimit_supported(void)
+{
+    return (kvm_enabled() && kvm_dirty_ring_enabled()) ||
+           (tcg_enabled() && qemu_tcg_mttcg_enabled());
+}
+
 static uint64_t dirtylimit_dirty_ring_full_time(uint64_t dirtyrate)
 {
     static uint64_t max_dirtyrate;
     uint64_t dirty_ring_size_MiB;
 
-    dirty_ring_size_MiB = qemu_target_pages_to_MiB(kvm_dirty_ring_size());
+    dirty_ring_size_MiB = qemu_target_pages_to_MiB(kvm_enabled() ?
+                                                   kvm_dirty_ring_size() :
+                                                   DIRTYLIMIT_TCG_RING_SIZE);
 
     if (max_dirtyrate < dirtyrate) {
         max_dirtyrate = dirtyrate;
@@ -424,6 +439,23 @@ void dirtylimit_vcpu_execute(CPUState *cpu)
     }
 }
 
+static void dirtylimit_vcpu_sleep(CPUState *cpu, run_on_cpu_data data)
+{
+    bql_unlock();
+    dirtylimit_vcpu_execute(cpu);
+    bql_lock();
+}
+
+/*
+ * TCG counterpart of KVM_EXIT_DIRTY_RING_FULL.  It is called from the
+ * store slow path, inside cpu_exec() and an RCU read-side critical
+ * section, so the sleep is deferred to the vCPU thread loop.
+ */
+void dirtylimit_vcpu_ring_full(CPUState *cpu)
+{
+    async_run_on_cpu(cpu, dirtylimit_vcpu_sleep, RUN_ON_CPU_NULL);
+}
+
 static void dirtylimit_init(void)
 {
     dirtylimit_state_initialize();
@@ -459,7 +491,7 @@ void qmp_cancel_vcpu_dirty_limit(bool has_cpu_index,
                                  int64_t cpu_index,
                                  Error **errp)
 {
-    if (!kvm_enabled() || !kvm_dirty_ring_enabled()) {
+    if (!dirtylimit_supported()) {
         return;
     }
 
@@ -513,9 +545,10 @@ void qmp_set_vcpu_dirty_limit(bool has_cpu_index,
                               uint64_t dirty_rate,
                               Error **errp)
 {
-    if (!kvm_enabled() || !kvm_dirty_ring_enabled()) {
-        error_setg(errp, "dirty page limit feature requires KVM with"
-                   " accelerator property 'dirty-ring-size' set'");
+    if (!dirtylimit_supported()) {
+        error_setg(errp, "dirty page limit feature requires multi-threaded"
+                   " TCG, or KVM with accelerator property 'dirty-ring-size'"
+                   " set");
         return;
     }
 
@@ -749,8 +749,30 @@ static MemoryRegion *memory_region_get_flatview_root(MemoryRegion *mr)
     return NULL;
 }
 
-/* Render a memory topology into a list of disjoint absolute ranges. */
-static FlatView *generate_memory_topology(MemoryRegion *mr)
+static bool flatview_equal(FlatView *a, FlatView *b)
+{
+    unsigned i;
+
+    if (a->root != b->root || a->nr != b->nr) {
+        return false;
+    }
+    for (i = 0; i < a->nr; i++) {
+        if (!flatrange_equal(&a->ranges[i], &b->ranges[i]) ||
+            a->ranges[i].dirty_log_mask != b->ranges[i].dirty_log_mask) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * Render a memory topology into a list of disjoint absolute ranges.
+ * If it comes out identical to @old_view, the view that @mr had before
+ * the transaction, keep @old_view together with its dispatch tree
+ * instead of building a new one.
+ */
+static FlatView *generate_memory_topology(MemoryRegion *mr,
+                                          FlatView *old_view)
 {
     int i;
     FlatView *view;
@@ -764,6 +786,14 @@ static FlatView *generate_memory_topology(MemoryRegion *mr)
     }
     flatview_simplify(view);
 
+    if (old_view && flatview_equal(view, old_view)) {
+        /* Never published, so no need to wait for RCU readers. */
+        flatview_destroy(view);
+        flatview_ref(old_view);
+        g_hash_table_replace(flat_views, mr, old_view);
+        return old_view;
+    }
+
     view->dispatch = address_space_dispatch_new(view);
     for (i = 0; i < view->nr; i++) {
         MemoryRegionSection mrs =
@@ -1053,7 +1083,7 @@ static void flatviews_init(void)
     flat_views = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL,
                                        (GDestroyNotify) flatview_unref);
     if (!empty_view) {
-        empty_view = generate_memory_topology(NULL);
+        empty_view = generate_memory_topology(NULL, NULL);
         /* We keep it alive forever in the global variable.  */
         flatview_ref(empty_view);
     } else {
@@ -1064,15 +1094,13 @@ static void flatviews_init(void)
 
 static void flatviews_reset(void)
 {
+    GHashTable *old_views = flat_views;
     AddressSpace *as;
 
-    if (flat_views) {
-        g_hash_table_unref(flat_views);
-        flat_views = NULL;
-    }
+    flat_views = NULL;
     flatviews_init();
 
-    /* Render unique FVs */
+    /* Render unique FVs, keeping those that did not change */
     QTAILQ_FOREACH(as, &address_spaces, address_spaces_link) {
         MemoryRegion *physmr = memory_region_get_flatview_root(as->root);
 
@@ -1080,7 +1108,13 @@ static void flatviews_reset(void)
             continue;
         }
 
-        generate_memory_topology(physmr);
+        generate_memory_topology(physmr, old_views ?
+                                 g_hash_table_lookup(old_views, physmr) :
+                                 NULL);
+    }
+
+    if (old_views) {
+        g_hash_table_unref(old_views);
     }
 }
 
@@ -1093,6 +1127,13 @@ static void address_space_set_flatview(AddressSpace *as)
     assert(new_view);
 
     if (old_view == new_view) {
+        /*
+         * Unchanged by this transaction.  Listeners that rebuild their
+         * state between begin and commit still need to see every range.
+         */
+        if (!QTAILQ_EMPTY(&as->listeners)) {
+            address_space_update_topology_pass(as, old_view, new_view, true);
+        }
         return;
     }
 
@@ -1135,7 +1176,7 @@ static void address_space_update_topology(AddressSpace *as)
 
     flatviews_init();
     if (!g_hash_table_lookup(flat_views, physmr)) {
-        generate_memory_topology(physmr);
+        generate_memory_topology(physmr, NULL);
     }
     address_space_set_flatview(as);
 }
@@ -2567,6 +2608,12 @@ void memory_region_clear_flush_coalesced(MemoryRegion *mr)
     }
 }
 
+void memory_region_enable_lockless_io(MemoryRegion *mr)
+{
+    mr->lockless_io = true;
+    mr->disable_reentrancy_guard = true;
+}
+
 void memory_region_add_eventfd(MemoryRegion *mr,
                                hwaddr addr,
                                unsigned size,
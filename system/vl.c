@@ -448,6 +448,9 @@ static QemuOptsList qemu_icount_opts = {
         }, {
             .name = "rrsnapshot",
             .type = QEMU_OPT_STRING,
+        }, {
+            .name = "rrperiod",
+            .type = QEMU_OPT_NUMBER,
         },
         { /* end of list */ }
     },
@@ -45,10 +45,13 @@ typedef struct CPUArchState CPURISCVState;
 
 /*
  * RISC-V-specific extra insn start words:
- * 1: Original instruction opcode
+ * 1: Original instruction opcode; above it, the PMU events counted inline
+ *    for this and the following insns of its run (see gen_pmu_events)
  * 2: more information about instruction
  */
 #define TARGET_INSN_START_EXTRA_WORDS 2
+#define RISCV_INSN_START_PMU_SHIFT 32
+#define RISCV_INSN_START_PMU_BITS 10
 /*
  * b0: Whether a instruction always raise a store AMO or not.
  */
@@ -194,6 +197,14 @@ typedef struct PMUFixedCtrState {
         uint64_t counter_virt_prev[2];
 } PMUFixedCtrState;
 
+/* PMU events counted inline by translated code */
+typedef enum RISCVPMUInlineEvent {
+    RISCV_PMU_INLINE_LOAD,
+    RISCV_PMU_INLINE_STORE,
+    RISCV_PMU_INLINE_BRANCH,
+    RISCV_PMU_INLINE_NUM
+} RISCVPMUInlineEvent;
+
 struct CPUArchState {
     target_ulong gpr[32];
     target_ulong gprh[32]; /* 64 top bits of the 128-bit registers */
@@ -404,6 +415,14 @@ struct CPUArchState {
 
     PMUFixedCtrState pmu_fixed_ctrs[2];
 
+    /*
+     * Events counted inline by translated code, batched per run of insns
+     * and folded into the mapped mhpmcounter by
+     * riscv_pmu_sync_inline_events().
+     */
+    uint64_t pmu_inline_events[RISCV_PMU_INLINE_NUM];
+    bool pmu_inline_active;
+
     target_ulong sscratch;
     target_ulong mscratch;
 
@@ -427,6 +446,8 @@ struct CPUArchState {
     QEMUTimer *itrigger_timer[RV_MAX_TRIGGERS];
     int64_t last_icount;
     bool itrigger_enabled;
+    int32_t itrigger_left;      /* insns until helper_itrigger_match */
+    int32_t itrigger_batch;     /* value itrigger_left was armed with */
 
     /* machine specific rdtime callback */
     uint64_t (*rdtime_fn)(void *);
@@ -640,6 +661,8 @@ FIELD(TB_FLAGS, FCFI_ENABLED, 28, 1)
 FIELD(TB_FLAGS, FCFI_LP_EXPECTED, 29, 1)
 /* zicfiss needs a TB flag so that correct TB is located based on tb flags */
 FIELD(TB_FLAGS, BCFI_ENABLED, 30, 1)
+/* Count PMU load/store/branch events inline */
+FIELD(TB_FLAGS, PMU_EVENTS, 31, 1)
 
 #ifdef TARGET_RISCV32
 #define riscv_cpu_mxl(env)  ((void)(env), MXL_RV32)
@@ -848,6 +871,9 @@ enum {
 enum riscv_pmu_event_idx {
     RISCV_PMU_EVENT_HW_CPU_CYCLES = 0x01,
     RISCV_PMU_EVENT_HW_INSTRUCTIONS = 0x02,
+    RISCV_PMU_EVENT_HW_BRANCH_INSTRUCTIONS = 0x05,
+    RISCV_PMU_EVENT_CACHE_L1D_READ_ACCESS = 0x10000,
+    RISCV_PMU_EVENT_CACHE_L1D_WRITE_ACCESS = 0x10002,
     RISCV_PMU_EVENT_CACHE_DTLB_READ_MISS = 0x10019,
     RISCV_PMU_EVENT_CACHE_DTLB_WRITE_MISS = 0x1001B,
     RISCV_PMU_EVENT_CACHE_ITLB_PREFETCH_MISS = 0x10021,
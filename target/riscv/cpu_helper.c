@@ -204,6 +204,10 @@ void cpu_get_tb_cpu_state(CPURISCVState *env, vaddr *pc,
     if (cpu->cfg.debug && !icount_enabled()) {
         flags = FIELD_DP32(flags, TB_FLAGS, ITRIGGER, env->itrigger_enabled);
     }
+
+    if (env->pmu_inline_active) {
+        flags = FIELD_DP32(flags, TB_FLAGS, PMU_EVENTS, 1);
+    }
 #endif
 
     flags = FIELD_DP32(flags, TB_FLAGS, FS, fs);
@@ -773,14 +777,35 @@ void riscv_cpu_set_aia_ireg_rmw_fn(CPURISCVState *env, uint32_t priv,
 
 void riscv_cpu_set_mode(CPURISCVState *env, target_ulong newpriv, bool virt_en)
 {
+    bool itrigger_rearm = false;
+
     g_assert(newpriv <= PRV_M && newpriv != PRV_RESERVED);
 
     if (newpriv != env->priv || env->virt_enabled != virt_en) {
         if (icount_enabled()) {
             riscv_itrigger_update_priv(env);
+        } else if (riscv_cpu_cfg(env)->debug) {
+            /* Retire the count down so far in the old mode. */
+            riscv_itrigger_sync(env);
+            itrigger_rearm = true;
         }
 
+        riscv_pmu_sync_inline_events(env);
         riscv_pmu_update_fixed_ctrs(env, newpriv, virt_en);
+
+        /*
+         * The U-mode two-stage mmu index is shared by HLV/HSV from U-mode,
+         * checked against hstatus.HUKTE, and every other VU-mode access,
+         * checked against senvcfg.UKTE (see do_svukte_check).  Entering or
+         * leaving U-mode with V=0 switches between the two rules.
+         */
+        if (riscv_cpu_cfg(env)->ext_svukte &&
+            (env->priv == PRV_U && !env->virt_enabled) !=
+            (newpriv == PRV_U && !virt_en) &&
+            get_field(env->hstatus, HSTATUS_HUKTE) !=
+            get_field(env->senvcfg, SENVCFG_UKTE)) {
+            tlb_flush_by_mmuidx(env_cpu(env), MMU_IDXMAP_2STAGE);
+        }
     }
 
     /* tlb_flush is unnecessary as mode is contained in mmu_idx */
@@ -799,11 +824,11 @@ void riscv_cpu_set_mode(CPURISCVState *env, target_ulong newpriv, bool virt_en)
     env->load_res = -1;
 
     if (riscv_has_ext(env, RVH)) {
-        /* Flush the TLB on all virt mode changes. */
-        if (env->virt_enabled != virt_en) {
-            tlb_flush(env_cpu(env));
-        }
-
+        /*
+         * No other TLB flush is needed on virt mode changes: V=1 uses
+         * its own mmu indexes, which are flushed on changes to vsatp,
+         * hgatp, vsstatus.MXR and the Svukte controls, and by hfence.
+         */
         env->virt_enabled = virt_en;
         if (virt_en) {
             /*
@@ -819,6 +844,10 @@ void riscv_cpu_set_mode(CPURISCVState *env, target_ulong newpriv, bool virt_en)
             riscv_cpu_update_mip(env, 0, 0);
         }
     }
+
+    if (itrigger_rearm) {
+        riscv_itrigger_rearm(env);
+    }
 }
 
 /*
@@ -917,6 +946,8 @@ static bool check_svukte_addr(CPURISCVState *env, vaddr addr)
  * @env: CPURISCVState
  * @physical: This will be set to the calculated physical address
  * @prot: The returned protection attributes
+ * @page_bits: If not NULL, this will be set to log2 of the size of the
+ *             mapping (superpage or Svnapot range) containing @addr
  * @addr: The virtual address or guest physical address to be translated
  * @fault_pte_addr: If not NULL, this will be set to fault pte address
  *                  when a error occurs on pte address translation.
@@ -929,7 +960,7 @@ static bool check_svukte_addr(CPURISCVState *env, vaddr addr)
  * @is_debug: Is this access from a debugger or the monitor?
  */
 static int get_physical_address(CPURISCVState *env, hwaddr *physical,
-                                int *ret_prot, vaddr addr,
+                                int *ret_prot, int *ret_page_bits, vaddr addr,
                                 target_ulong *fault_pte_addr,
                                 int access_type, int mmu_idx,
                                 bool first_stage, bool two_stage,
@@ -1085,7 +1116,8 @@ restart:
 
             /* Do the second stage translation on the base PTE address. */
             int vbase_ret = get_physical_address(env, &vbase, &vbase_prot,
-                                                 base, NULL, MMU_DATA_LOAD,
+                                                 NULL, base, NULL,
+                                                 MMU_DATA_LOAD,
                                                  MMUIdx_U, false, true,
                                                  is_debug, false);
 
@@ -1326,6 +1358,9 @@ restart:
     *physical = (((ppn & ~napot_mask) | (vpn & napot_mask) |
                   (vpn & (((target_ulong)1 << ptshift) - 1))
                  ) << PGSHIFT) | (addr & ~TARGET_PAGE_MASK);
+    if (ret_page_bits) {
+        *ret_page_bits = PGSHIFT + MAX(ptshift, napot_bits);
+    }
 
     /*
      * Remove write permission unless this is a store, or the page is
@@ -1391,14 +1426,15 @@ hwaddr riscv_cpu_get_phys_page_debug(CPUState *cs, vaddr addr)
     int prot;
     int mmu_idx = riscv_env_mmu_index(&cpu->env, false);
 
-    if (get_physical_address(env, &phys_addr, &prot, addr, NULL, 0, mmu_idx,
-                             true, env->virt_enabled, true, false)) {
+    if (get_physical_address(env, &phys_addr, &prot, NULL, addr, NULL, 0,
+                             mmu_idx, true, env->virt_enabled, true, false)) {
         return -1;
     }
 
     if (env->virt_enabled) {
-        if (get_physical_address(env, &phys_addr, &prot, phys_addr, NULL,
-                                 0, MMUIdx_U, false, true, true, false)) {
+        if (get_physical_address(env, &phys_addr, &prot, NULL, phys_addr,
+                                 NULL, 0, MMUIdx_U, false, true, true,
+                                 false)) {
             return -1;
         }
     }
@@ -1484,6 +1520,50 @@ static void pmu_tlb_fill_incr_ctr(RISCVCPU *cpu, MMUAccessType access_type)
     riscv_pmu_incr_ctr(cpu, pmu_event_type);
 }
 
+/*
+ * Superpages and Svnapot ranges map a naturally aligned, contiguous
+ * range, so one page table walk also gives us the translation of the
+ * pages around @address.  Install up to 1 << RISCV_TLB_PREFILL_BITS
+ * of them, PMP permitting, so that walking a superpage does not take
+ * one TLB miss per TARGET_PAGE_SIZE.
+ *
+ * The entries are plain TARGET_PAGE_SIZE entries rather than one
+ * large page: SFENCE.VMA and HFENCE always flush whole MMU indexes,
+ * so tlb_add_large_page() would buy nothing and would only turn the
+ * single-page flushes done for e.g. watchpoints into flushes of the
+ * whole index.
+ */
+#define RISCV_TLB_PREFILL_BITS 4
+
+static void riscv_cpu_tlb_fill_superpage(CPUState *cs, vaddr address,
+                                         hwaddr pa, int prot, int page_bits,
+                                         MMUAccessType access_type,
+                                         int mmu_idx, int mode)
+{
+    CPURISCVState *env = cpu_env(cs);
+    int bits = MIN(page_bits, TARGET_PAGE_BITS + RISCV_TLB_PREFILL_BITS);
+    vaddr mask = ((vaddr)1 << bits) - 1;
+    vaddr va_base = address & ~mask;
+    hwaddr pa_base = pa & ~(hwaddr)mask;
+    vaddr off;
+
+    for (off = 0; off <= mask; off += TARGET_PAGE_SIZE) {
+        int prot_pmp;
+
+        if (va_base + off == (address & TARGET_PAGE_MASK)) {
+            continue;
+        }
+        if (get_physical_address_pmp(env, &prot_pmp, pa_base + off,
+                                     TARGET_PAGE_SIZE, access_type,
+                                     mode) != TRANSLATE_SUCCESS ||
+            pmp_get_tlb_size(env, pa_base + off) != TARGET_PAGE_SIZE) {
+            continue;
+        }
+        tlb_set_page(cs, va_base + off, pa_base + off, prot & prot_pmp,
+                     mmu_idx, TARGET_PAGE_SIZE);
+    }
+}
+
 bool riscv_cpu_tlb_fill(CPUState *cs, vaddr address, int size,
                         MMUAccessType access_type, int mmu_idx,
                         bool probe, uintptr_t retaddr)
@@ -1492,7 +1572,9 @@ bool riscv_cpu_tlb_fill(CPUState *cs, vaddr address, int size,
     CPURISCVState *env = &cpu->env;
     vaddr im_address;
     hwaddr pa = 0;
-    int prot, prot2, prot_pmp;
+    int prot, prot2, prot_pmp, prot_vm = 0;
+    /* A bare G-stage does not limit the size of the VS-stage mapping. */
+    int page_bits = TARGET_PAGE_BITS, page_bits2 = TARGET_LONG_BITS;
     bool pmp_violation = false;
     bool first_stage_error = true;
     bool two_stage_lookup = mmuidx_2stage(mmu_idx);
@@ -1510,7 +1592,7 @@ bool riscv_cpu_tlb_fill(CPUState *cs, vaddr address, int size,
     pmu_tlb_fill_incr_ctr(cpu, access_type);
     if (two_stage_lookup) {
         /* Two stage lookup */
-        ret = get_physical_address(env, &pa, &prot, address,
+        ret = get_physical_address(env, &pa, &prot, &page_bits, address,
                                    &env->guest_phys_fault_addr, access_type,
                                    mmu_idx, true, true, false, probe);
 
@@ -1533,9 +1615,9 @@ bool riscv_cpu_tlb_fill(CPUState *cs, vaddr address, int size,
             /* Second stage lookup */
             im_address = pa;
 
-            ret = get_physical_address(env, &pa, &prot2, im_address, NULL,
-                                       access_type, MMUIdx_U, false, true,
-                                       false, probe);
+            ret = get_physical_address(env, &pa, &prot2, &page_bits2,
+                                       im_address, NULL, access_type,
+                                       MMUIdx_U, false, true, false, probe);
 
             qemu_log_mask(CPU_LOG_MMU,
                           "%s 2nd-stage address=%" VADDR_PRIx
@@ -1544,8 +1626,10 @@ bool riscv_cpu_tlb_fill(CPUState *cs, vaddr address, int size,
                           __func__, im_address, ret, pa, prot2);
 
             prot &= prot2;
+            page_bits = MIN(page_bits, page_bits2);
 
             if (ret == TRANSLATE_SUCCESS) {
+                prot_vm = prot;
                 ret = get_physical_address_pmp(env, &prot_pmp, pa,
                                                size, access_type, mode);
                 tlb_size = pmp_get_tlb_size(env, pa);
@@ -1571,9 +1655,9 @@ bool riscv_cpu_tlb_fill(CPUState *cs, vaddr address, int size,
         }
     } else {
         /* Single stage lookup */
-        ret = get_physical_address(env, &pa, &prot, address, NULL,
-                                   access_type, mmu_idx, true, false, false,
-                                   probe);
+        ret = get_physical_address(env, &pa, &prot, &page_bits, address,
+                                   NULL, access_type, mmu_idx, true, false,
+                                   false, probe);
 
         qemu_log_mask(CPU_LOG_MMU,
                       "%s address=%" VADDR_PRIx " ret %d physical "
@@ -1581,6 +1665,7 @@ bool riscv_cpu_tlb_fill(CPUState *cs, vaddr address, int size,
                       __func__, address, ret, pa, prot);
 
         if (ret == TRANSLATE_SUCCESS) {
+            prot_vm = prot;
             ret = get_physical_address_pmp(env, &prot_pmp, pa,
                                            size, access_type, mode);
             tlb_size = pmp_get_tlb_size(env, pa);
@@ -1599,6 +1684,10 @@ bool riscv_cpu_tlb_fill(CPUState *cs, vaddr address, int size,
     }
 
     if (ret == TRANSLATE_SUCCESS) {
+        if (page_bits > TARGET_PAGE_BITS && tlb_size == TARGET_PAGE_SIZE) {
+            riscv_cpu_tlb_fill_superpage(cs, address, pa, prot_vm, page_bits,
+                                         access_type, mmu_idx, mode);
+        }
         tlb_set_page(cs, address & ~(tlb_size - 1), pa & ~(tlb_size - 1),
                      prot, mmu_idx, tlb_size);
         return true;
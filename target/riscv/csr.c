@@ -21,6 +21,7 @@
 #include "qemu/log.h"
 #include "qemu/timer.h"
 #include "cpu.h"
+#include "internals.h"
 #include "tcg/tcg-cpu.h"
 #include "pmu.h"
 #include "time_helper.h"
@@ -981,6 +982,8 @@ static RISCVException write_mhpmevent(CPURISCVState *env, int csrno,
     uint64_t mhpmevt_val = val;
     uint64_t inh_avail_mask;
 
+    riscv_pmu_sync_inline_events(env);
+
     if (riscv_cpu_mxl(env) == MXL_RV32) {
         env->mhpmevent_val[evt_index] = val;
         mhpmevt_val = mhpmevt_val |
@@ -1028,6 +1031,8 @@ static RISCVException write_mhpmeventh(CPURISCVState *env, int csrno,
     inh_avail_mask |= (riscv_has_ext(env, RVH) &&
                        riscv_has_ext(env, RVS)) ? MHPMEVENTH_BIT_VSINH : 0;
 
+    riscv_pmu_sync_inline_events(env);
+
     mhpmevth_val = val & inh_avail_mask;
     mhpmevt_val = mhpmevt_val | (mhpmevth_val << 32);
     env->mhpmeventh_val[evt_index] = mhpmevth_val;
@@ -1111,6 +1116,7 @@ static RISCVException write_mhpmcounter(CPURISCVState *env, int csrno,
     PMUCTRState *counter = &env->pmu_ctrs[ctr_idx];
     uint64_t mhpmctr_val = val;
 
+    riscv_pmu_sync_inline_events(env);
     counter->mhpmcounter_val = val;
     if (!get_field(env->mcountinhibit, BIT(ctr_idx)) &&
         (riscv_pmu_ctr_monitor_cycles(env, ctr_idx) ||
@@ -1140,6 +1146,8 @@ static RISCVException write_mhpmcounterh(CPURISCVState *env, int csrno,
     uint64_t mhpmctr_val = counter->mhpmcounter_val;
     uint64_t mhpmctrh_val = val;
 
+    riscv_pmu_sync_inline_events(env);
+    mhpmctr_val = counter->mhpmcounter_val;
     counter->mhpmcounterh_val = val;
     mhpmctr_val = mhpmctr_val | (mhpmctrh_val << 32);
     if (!get_field(env->mcountinhibit, BIT(ctr_idx)) &&
@@ -1163,8 +1171,11 @@ RISCVException riscv_pmu_read_ctr(CPURISCVState *env, target_ulong *val,
     PMUCTRState *counter = &env->pmu_ctrs[ctr_idx];
     target_ulong ctr_prev = upper_half ? counter->mhpmcounterh_prev :
                                          counter->mhpmcounter_prev;
-    target_ulong ctr_val = upper_half ? counter->mhpmcounterh_val :
-                                        counter->mhpmcounter_val;
+    target_ulong ctr_val;
+
+    riscv_pmu_sync_inline_events(env);
+    ctr_val = upper_half ? counter->mhpmcounterh_val :
+                           counter->mhpmcounter_val;
 
     if (get_field(env->mcountinhibit, BIT(ctr_idx))) {
         /*
@@ -1542,7 +1553,7 @@ static bool validate_vm(CPURISCVState *env, target_ulong vm)
 }
 
 static target_ulong legalize_xatp(CPURISCVState *env, target_ulong old_xatp,
-                                  target_ulong val)
+                                  target_ulong val, uint16_t idxmap)
 {
     target_ulong mask;
     bool vm;
@@ -1561,7 +1572,7 @@ static target_ulong legalize_xatp(CPURISCVState *env, target_ulong old_xatp,
          * performance.  Flushing the TLB on SATP writes with paging
          * enabled avoids leaking those invalid cached mappings.
          */
-        tlb_flush(env_cpu(env));
+        tlb_flush_by_mmuidx(env_cpu(env), idxmap);
         return val;
     }
     return old_xatp;
@@ -2217,6 +2228,8 @@ static RISCVException write_mcountinhibit(CPURISCVState *env, int csrno,
     target_ulong updated_ctrs = (env->mcountinhibit ^ val) & present_ctrs;
     uint64_t mhpmctr_val, prev_count, curr_count;
 
+    riscv_pmu_sync_inline_events(env);
+
     /* WARL register - disable unavailable counters; TM bit is always 0 */
     env->mcountinhibit = val & present_ctrs;
 
@@ -2457,6 +2470,10 @@ static RISCVException write_senvcfg(CPURISCVState *env, int csrno,
         mask |= SENVCFG_UKTE;
     }
 
+    /* UKTE is checked when U and VU-mode TLB entries are filled */
+    if ((env->senvcfg ^ val) & mask & SENVCFG_UKTE) {
+        tlb_flush(env_cpu(env));
+    }
     env->senvcfg = (env->senvcfg & ~mask) | (val & mask);
     return RISCV_EXCP_NONE;
 }
@@ -3402,7 +3419,10 @@ static RISCVException write_satp(CPURISCVState *env, int csrno,
         return RISCV_EXCP_NONE;
     }
 
-    env->satp = legalize_xatp(env, env->satp, val);
+    /* While V=1, satp holds the guest's vsatp. */
+    env->satp = legalize_xatp(env, env->satp, val,
+                              env->virt_enabled ? MMU_IDXMAP_2STAGE
+                                                : MMU_IDXMAP_1STAGE);
     return RISCV_EXCP_NONE;
 }
 
@@ -3543,6 +3563,9 @@ static RISCVException write_hstatus(CPURISCVState *env, int csrno,
     if (!env_archcpu(env)->cfg.ext_svukte) {
         val = val & (~HSTATUS_HUKTE);
     }
+    if ((env->hstatus ^ val) & HSTATUS_HUKTE) {
+        tlb_flush_by_mmuidx(env_cpu(env), MMU_IDXMAP_2STAGE);
+    }
     env->hstatus = val;
     if (riscv_cpu_mxl(env) != MXL_RV32 && get_field(val, HSTATUS_VSXL) != 2) {
         qemu_log_mask(LOG_UNIMP,
@@ -3923,7 +3946,7 @@ static RISCVException read_hgatp(CPURISCVState *env, int csrno,
 static RISCVException write_hgatp(CPURISCVState *env, int csrno,
                                   target_ulong val)
 {
-    env->hgatp = legalize_xatp(env, env->hgatp, val);
+    env->hgatp = legalize_xatp(env, env->hgatp, val, MMU_IDXMAP_2STAGE);
     return RISCV_EXCP_NONE;
 }
 
@@ -4113,10 +4136,18 @@ static RISCVException write_vsstatus(CPURISCVState *env, int csrno,
                                      target_ulong val)
 {
     uint64_t mask = (target_ulong)-1;
+    uint64_t vsstatus;
+
     if ((val & VSSTATUS64_UXL) == 0) {
         mask &= ~VSSTATUS64_UXL;
     }
-    env->vsstatus = (env->vsstatus & ~mask) | (uint64_t)val;
+    vsstatus = (env->vsstatus & ~mask) | (uint64_t)val;
+
+    /* MXR affects the permissions cached for two-stage translations. */
+    if ((vsstatus ^ env->vsstatus) & MSTATUS_MXR) {
+        tlb_flush_by_mmuidx(env_cpu(env), MMU_IDXMAP_2STAGE);
+    }
+    env->vsstatus = vsstatus;
     return RISCV_EXCP_NONE;
 }
 
@@ -4205,7 +4236,7 @@ static RISCVException read_vsatp(CPURISCVState *env, int csrno,
 static RISCVException write_vsatp(CPURISCVState *env, int csrno,
                                   target_ulong val)
 {
-    env->vsatp = legalize_xatp(env, env->vsatp, val);
+    env->vsatp = legalize_xatp(env, env->vsatp, val, MMU_IDXMAP_2STAGE);
     return RISCV_EXCP_NONE;
 }
 
@@ -4354,7 +4385,10 @@ static RISCVException write_mcontext(CPURISCVState *env, int csrno,
         mask = rv32 ? MCONTEXT32 : MCONTEXT64;
     }
 
+    /* The context takes part in matching icount triggers. */
+    riscv_itrigger_sync(env);
     env->mcontext = val & mask;
+    riscv_itrigger_rearm(env);
     return RISCV_EXCP_NONE;
 }
 
@@ -718,9 +718,28 @@ bool riscv_itrigger_enabled(CPURISCVState *env)
     return false;
 }
 
-void helper_itrigger_match(CPURISCVState *env)
+/*
+ * Without icount, translated code counts env->itrigger_left down after
+ * each instruction and only calls helper_itrigger_match when it reaches
+ * zero.  It is armed with the smallest count of the icount triggers that
+ * match in the current mode, so no trigger can fire earlier, and the
+ * counts in tdata1 lag behind by the instructions retired since then.
+ */
+static int itrigger_get_executed(CPURISCVState *env)
+{
+    if (env->itrigger_batch <= 0) {
+        return 0;
+    }
+    return MIN(MAX(env->itrigger_batch - env->itrigger_left, 0),
+               env->itrigger_batch);
+}
+
+/* Retire @executed instructions; return the triggers that reached zero. */
+static uint32_t itrigger_retire(CPURISCVState *env, int executed)
 {
+    uint32_t hit = 0;
     int count;
+
     for (int i = 0; i < RV_MAX_TRIGGERS; i++) {
         if (get_trigger_type(env, i) != TRIGGER_TYPE_INST_CNT) {
             continue;
@@ -732,10 +751,54 @@ void helper_itrigger_match(CPURISCVState *env)
         if (!count) {
             continue;
         }
-        itrigger_set_count(env, i, count--);
+        count -= MIN(count, executed);
+        itrigger_set_count(env, i, count);
         if (!count) {
-            env->itrigger_enabled = riscv_itrigger_enabled(env);
-            do_trigger_action(env, i);
+            hit |= 1 << i;
+        }
+    }
+    return hit;
+}
+
+void riscv_itrigger_rearm(CPURISCVState *env)
+{
+    int batch = 0, count;
+
+    for (int i = 0; i < RV_MAX_TRIGGERS; i++) {
+        if (get_trigger_type(env, i) != TRIGGER_TYPE_INST_CNT) {
+            continue;
+        }
+        if (!trigger_common_match(env, TRIGGER_TYPE_INST_CNT, i)) {
+            continue;
+        }
+        count = itrigger_get_count(env, i);
+        if (count && (!batch || count < batch)) {
+            batch = count;
+        }
+    }
+    env->itrigger_batch = batch;
+    env->itrigger_left = batch;
+}
+
+void riscv_itrigger_sync(CPURISCVState *env)
+{
+    /* Cannot hit: the count down stops at zero before anything could. */
+    itrigger_retire(env, itrigger_get_executed(env));
+    env->itrigger_batch = 0;
+    env->itrigger_left = 0;
+}
+
+void helper_itrigger_match(CPURISCVState *env)
+{
+    uint32_t hit = itrigger_retire(env, itrigger_get_executed(env));
+
+    riscv_itrigger_rearm(env);
+    if (hit) {
+        env->itrigger_enabled = riscv_itrigger_enabled(env);
+        for (int i = 0; i < RV_MAX_TRIGGERS; i++) {
+            if (hit & (1 << i)) {
+                do_trigger_action(env, i);
+            }
         }
     }
 }
@@ -872,6 +935,10 @@ target_ulong tdata_csr_read(CPURISCVState *env, int tdata_index)
             return deposit64(env->tdata1[env->trigger_cur], 10, 14,
                              itrigger_get_adjust_count(env));
         }
+        if (trigger_type == TRIGGER_TYPE_INST_CNT) {
+            riscv_itrigger_sync(env);
+            riscv_itrigger_rearm(env);
+        }
         return env->tdata1[env->trigger_cur];
     case TDATA2:
         return env->tdata2[env->trigger_cur];
@@ -892,6 +959,10 @@ void tdata_csr_write(CPURISCVState *env, int tdata_index, target_ulong val)
         trigger_type = get_trigger_type(env, env->trigger_cur);
     }
 
+    if (!icount_enabled()) {
+        riscv_itrigger_sync(env);
+    }
+
     switch (trigger_type) {
     case TRIGGER_TYPE_AD_MATCH:
         type2_reg_write(env, env->trigger_cur, tdata_index, val);
@@ -916,6 +987,10 @@ void tdata_csr_write(CPURISCVState *env, int tdata_index, target_ulong val)
     default:
         g_assert_not_reached();
     }
+
+    if (!icount_enabled()) {
+        riscv_itrigger_rearm(env);
+    }
 }
 
 target_ulong tinfo_csr_read(CPURISCVState *env)
@@ -1086,4 +1161,6 @@ void riscv_trigger_reset_hold(CPURISCVState *env)
     }
 
     env->mcontext = 0;
+    env->itrigger_batch = 0;
+    env->itrigger_left = 0;
 }
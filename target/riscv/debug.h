@@ -153,4 +153,6 @@ void riscv_trigger_reset_hold(CPURISCVState *env);
 
 bool riscv_itrigger_enabled(CPURISCVState *env);
 void riscv_itrigger_update_priv(CPURISCVState *env);
+void riscv_itrigger_sync(CPURISCVState *env);
+void riscv_itrigger_rearm(CPURISCVState *env);
 #endif /* RISCV_DEBUG_H */
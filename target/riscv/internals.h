@@ -43,6 +43,14 @@
 #define MMU_2STAGE_BIT      (1 << 2)
 #define MMU_IDX_SS_WRITE    (1 << 3)
 
+/*
+ * V=1 translations, and HLV/HSV or MPRV+MPV accesses from V=0, all use
+ * the two-stage mmu indexes; everything else uses the others.  The two
+ * sets can therefore be flushed independently.
+ */
+#define MMU_IDXMAP_2STAGE   0xf0f0
+#define MMU_IDXMAP_1STAGE   0x0f0f
+
 static inline int mmuidx_priv(int mmu_idx)
 {
     int ret = mmu_idx & 3;
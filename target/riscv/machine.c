@@ -23,6 +23,7 @@
 #include "migration/cpu.h"
 #include "system/cpu-timers.h"
 #include "debug.h"
+#include "pmu.h"
 
 static bool pmp_needed(void *opaque)
 {
@@ -233,6 +234,20 @@ static bool debug_needed(void *opaque)
     return cpu->cfg.debug;
 }
 
+static int debug_pre_save(void *opaque)
+{
+    RISCVCPU *cpu = opaque;
+    CPURISCVState *env = &cpu->env;
+
+    /* Bring the icount trigger counts in tdata1 up to date. */
+    if (!icount_enabled()) {
+        riscv_itrigger_sync(env);
+        riscv_itrigger_rearm(env);
+    }
+
+    return 0;
+}
+
 static int debug_post_load(void *opaque, int version_id)
 {
     RISCVCPU *cpu = opaque;
@@ -240,6 +255,8 @@ static int debug_post_load(void *opaque, int version_id)
 
     if (icount_enabled()) {
         env->itrigger_enabled = riscv_itrigger_enabled(env);
+    } else {
+        riscv_itrigger_rearm(env);
     }
 
     return 0;
@@ -250,6 +267,7 @@ static const VMStateDescription vmstate_debug = {
     .version_id = 2,
     .minimum_version_id = 2,
     .needed = debug_needed,
+    .pre_save = debug_pre_save,
     .post_load = debug_post_load,
     .fields = (const VMStateField[]) {
         VMSTATE_UINTTL(env.trigger_cur, RISCVCPU),
@@ -260,6 +278,15 @@ static const VMStateDescription vmstate_debug = {
     }
 };
 
+static int riscv_cpu_pre_save(void *opaque)
+{
+    RISCVCPU *cpu = opaque;
+
+    /* Events counted inline are not migrated, fold them into the counters */
+    riscv_pmu_sync_inline_events(&cpu->env);
+    return 0;
+}
+
 static int riscv_cpu_post_load(void *opaque, int version_id)
 {
     RISCVCPU *cpu = opaque;
@@ -390,6 +417,7 @@ const VMStateDescription vmstate_riscv_cpu = {
     .name = "cpu",
     .version_id = 10,
     .minimum_version_id = 10,
+    .pre_save = riscv_cpu_pre_save,
     .post_load = riscv_cpu_post_load,
     .fields = (const VMStateField[]) {
         VMSTATE_UINTTL_ARRAY(env.gpr, RISCVCPU, 32),
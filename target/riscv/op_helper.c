@@ -24,6 +24,9 @@
 #include "exec/exec-all.h"
 #include "exec/cpu_ldst.h"
 #include "exec/helper-proto.h"
+#ifdef CONFIG_USER_ONLY
+#include "user/libc-intercept.h"
+#endif
 
 /* Exceptions processing helpers */
 G_NORETURN void riscv_raise_exception(CPURISCVState *env,
@@ -257,6 +260,21 @@ void helper_cbo_inval(CPURISCVState *env, target_ulong address)
     /* We don't emulate the cache-hierarchy, so we're done. */
 }
 
+#ifdef CONFIG_USER_ONLY
+
+uint32_t helper_libc_call(CPURISCVState *env, uint32_t func)
+{
+    target_ulong ret;
+
+    if (!libc_intercept_call(env_cpu(env), func, &env->gpr[xA0], &ret)) {
+        return 0;
+    }
+    env->gpr[xA0] = ret;
+    return 1;
+}
+
+#endif /* CONFIG_USER_ONLY */
+
 #ifndef CONFIG_USER_ONLY
 
 target_ulong helper_sret(CPURISCVState *env)
@@ -412,7 +430,9 @@ void helper_tlb_flush(CPURISCVState *env)
                (env->priv == PRV_U || get_field(env->hstatus, HSTATUS_VTVM))) {
         riscv_raise_exception(env, RISCV_EXCP_VIRT_INSTRUCTION_FAULT, GETPC());
     } else {
-        tlb_flush(cs);
+        /* SFENCE.VMA only affects the translations of the current V mode. */
+        tlb_flush_by_mmuidx(cs, env->virt_enabled ? MMU_IDXMAP_2STAGE
+                                                  : MMU_IDXMAP_1STAGE);
     }
 }
 
@@ -432,7 +452,8 @@ void helper_hyp_tlb_flush(CPURISCVState *env)
 
     if (env->priv == PRV_M ||
         (env->priv == PRV_S && !env->virt_enabled)) {
-        tlb_flush(cs);
+        /* VS-stage and G-stage translations only live in these indexes. */
+        tlb_flush_by_mmuidx(cs, MMU_IDXMAP_2STAGE);
         return;
     }
 
@@ -36,7 +36,7 @@
  */
 void riscv_pmu_generate_fdt_node(void *fdt, uint32_t cmask, char *pmu_name)
 {
-    uint32_t fdt_event_ctr_map[15] = {};
+    uint32_t fdt_event_ctr_map[24] = {};
 
    /*
     * The event encoding is specified in the SBI specification
@@ -74,6 +74,21 @@ void riscv_pmu_generate_fdt_node(void *fdt, uint32_t cmask, char *pmu_name)
    fdt_event_ctr_map[13] = cpu_to_be32(0x00010021);
    fdt_event_ctr_map[14] = cpu_to_be32(cmask);
 
+   /* SBI_PMU_HW_BRANCH_INSTRUCTIONS: 0x05 : type(0x00) */
+   fdt_event_ctr_map[15] = cpu_to_be32(0x00000005);
+   fdt_event_ctr_map[16] = cpu_to_be32(0x00000005);
+   fdt_event_ctr_map[17] = cpu_to_be32(cmask);
+
+   /* SBI_PMU_HW_CACHE_L1D : 0x00 READ : 0x00 ACCESS : 0x00 type(0x01) */
+   fdt_event_ctr_map[18] = cpu_to_be32(0x00010000);
+   fdt_event_ctr_map[19] = cpu_to_be32(0x00010000);
+   fdt_event_ctr_map[20] = cpu_to_be32(cmask);
+
+   /* SBI_PMU_HW_CACHE_L1D : 0x00 WRITE : 0x01 ACCESS : 0x00 type(0x01) */
+   fdt_event_ctr_map[21] = cpu_to_be32(0x00010002);
+   fdt_event_ctr_map[22] = cpu_to_be32(0x00010002);
+   fdt_event_ctr_map[23] = cpu_to_be32(cmask);
+
    /* This a OpenSBI specific DT property documented in OpenSBI docs */
    qemu_fdt_setprop(fdt, pmu_name, "riscv,event-to-mhpmcounters",
                     fdt_event_ctr_map, sizeof(fdt_event_ctr_map));
@@ -101,12 +116,13 @@ static bool riscv_pmu_counter_enabled(RISCVCPU *cpu, uint32_t ctr_idx)
     }
 }
 
-static int riscv_pmu_incr_ctr_rv32(RISCVCPU *cpu, uint32_t ctr_idx)
+static int riscv_pmu_incr_ctr_rv32(RISCVCPU *cpu, uint32_t ctr_idx,
+                                   uint64_t delta)
 {
     CPURISCVState *env = &cpu->env;
-    target_ulong max_val = UINT32_MAX;
     PMUCTRState *counter = &env->pmu_ctrs[ctr_idx];
     bool virt_on = env->virt_enabled;
+    uint64_t old_val, new_val;
 
     /* Privilege mode filtering */
     if ((env->priv == PRV_M &&
@@ -122,32 +138,31 @@ static int riscv_pmu_incr_ctr_rv32(RISCVCPU *cpu, uint32_t ctr_idx)
         return 0;
     }
 
+    old_val = (uint32_t)counter->mhpmcounter_val |
+              ((uint64_t)counter->mhpmcounterh_val << 32);
+    new_val = old_val + delta;
+    counter->mhpmcounter_val = (uint32_t)new_val;
+    counter->mhpmcounterh_val = new_val >> 32;
+
     /* Handle the overflow scenario */
-    if (counter->mhpmcounter_val == max_val) {
-        if (counter->mhpmcounterh_val == max_val) {
-            counter->mhpmcounter_val = 0;
-            counter->mhpmcounterh_val = 0;
-            /* Generate interrupt only if OF bit is clear */
-            if (!(env->mhpmeventh_val[ctr_idx] & MHPMEVENTH_BIT_OF)) {
-                env->mhpmeventh_val[ctr_idx] |= MHPMEVENTH_BIT_OF;
-                riscv_cpu_update_mip(env, MIP_LCOFIP, BOOL_TO_MASK(1));
-            }
-        } else {
-            counter->mhpmcounterh_val++;
+    if (new_val < old_val) {
+        /* Generate interrupt only if OF bit is clear */
+        if (!(env->mhpmeventh_val[ctr_idx] & MHPMEVENTH_BIT_OF)) {
+            env->mhpmeventh_val[ctr_idx] |= MHPMEVENTH_BIT_OF;
+            riscv_cpu_update_mip(env, MIP_LCOFIP, BOOL_TO_MASK(1));
         }
-    } else {
-        counter->mhpmcounter_val++;
     }
 
     return 0;
 }
 
-static int riscv_pmu_incr_ctr_rv64(RISCVCPU *cpu, uint32_t ctr_idx)
+static int riscv_pmu_incr_ctr_rv64(RISCVCPU *cpu, uint32_t ctr_idx,
+                                   uint64_t delta)
 {
     CPURISCVState *env = &cpu->env;
     PMUCTRState *counter = &env->pmu_ctrs[ctr_idx];
-    uint64_t max_val = UINT64_MAX;
     bool virt_on = env->virt_enabled;
+    uint64_t old_val = counter->mhpmcounter_val;
 
     /* Privilege mode filtering */
     if ((env->priv == PRV_M &&
@@ -163,16 +178,15 @@ static int riscv_pmu_incr_ctr_rv64(RISCVCPU *cpu, uint32_t ctr_idx)
         return 0;
     }
 
+    counter->mhpmcounter_val = old_val + delta;
+
     /* Handle the overflow scenario */
-    if (counter->mhpmcounter_val == max_val) {
-        counter->mhpmcounter_val = 0;
+    if (counter->mhpmcounter_val < old_val) {
         /* Generate interrupt only if OF bit is clear */
         if (!(env->mhpmevent_val[ctr_idx] & MHPMEVENT_BIT_OF)) {
             env->mhpmevent_val[ctr_idx] |= MHPMEVENT_BIT_OF;
             riscv_cpu_update_mip(env, MIP_LCOFIP, BOOL_TO_MASK(1));
         }
-    } else {
-        counter->mhpmcounter_val++;
     }
     return 0;
 }
@@ -272,7 +286,9 @@ void riscv_pmu_update_fixed_ctrs(CPURISCVState *env, target_ulong newpriv,
     riscv_pmu_icount_update_priv(env, newpriv, new_virt);
 }
 
-int riscv_pmu_incr_ctr(RISCVCPU *cpu, enum riscv_pmu_event_idx event_idx)
+static int riscv_pmu_incr_ctr_by(RISCVCPU *cpu,
+                                 enum riscv_pmu_event_idx event_idx,
+                                 uint64_t delta)
 {
     uint32_t ctr_idx;
     int ret;
@@ -294,14 +310,81 @@ int riscv_pmu_incr_ctr(RISCVCPU *cpu, enum riscv_pmu_event_idx event_idx)
     }
 
     if (riscv_cpu_mxl(env) == MXL_RV32) {
-        ret = riscv_pmu_incr_ctr_rv32(cpu, ctr_idx);
+        ret = riscv_pmu_incr_ctr_rv32(cpu, ctr_idx, delta);
     } else {
-        ret = riscv_pmu_incr_ctr_rv64(cpu, ctr_idx);
+        ret = riscv_pmu_incr_ctr_rv64(cpu, ctr_idx, delta);
     }
 
     return ret;
 }
 
+int riscv_pmu_incr_ctr(RISCVCPU *cpu, enum riscv_pmu_event_idx event_idx)
+{
+    return riscv_pmu_incr_ctr_by(cpu, event_idx, 1);
+}
+
+/* SBI event counted by each of the RISCVPMUInlineEvent slots */
+static const enum riscv_pmu_event_idx pmu_inline_event_idx[] = {
+    [RISCV_PMU_INLINE_LOAD] = RISCV_PMU_EVENT_CACHE_L1D_READ_ACCESS,
+    [RISCV_PMU_INLINE_STORE] = RISCV_PMU_EVENT_CACHE_L1D_WRITE_ACCESS,
+    [RISCV_PMU_INLINE_BRANCH] = RISCV_PMU_EVENT_HW_BRANCH_INSTRUCTIONS,
+};
+
+/*
+ * Translated code adds the number of loads, stores and branches of each run
+ * of insns to env->pmu_inline_events when the run starts, without looking
+ * at the counter configuration.  Fold those counts into the mapped
+ * counters; this must happen before the counters are read or written,
+ * before their mapping or inhibit state changes, and before a privilege
+ * mode change so that the mode filtering applies to the mode the events
+ * happened in.
+ */
+void riscv_pmu_sync_inline_events(CPURISCVState *env)
+{
+    RISCVCPU *cpu = env_archcpu(env);
+    uint64_t delta;
+    int i;
+
+    for (i = 0; i < RISCV_PMU_INLINE_NUM; i++) {
+        delta = env->pmu_inline_events[i];
+        if (delta) {
+            env->pmu_inline_events[i] = 0;
+            riscv_pmu_incr_ctr_by(cpu, pmu_inline_event_idx[i], delta);
+        }
+    }
+}
+
+/*
+ * An exception left translated code in the middle of a run of insns.
+ * @counts, packed as in insn start word 1, are the events of the faulting
+ * insn and those after it in the run: they were added when the run
+ * started but did not happen, and are counted again on re-execution.
+ */
+void riscv_pmu_unwind_inline_events(CPURISCVState *env, uint64_t counts)
+{
+    int i;
+
+    for (i = 0; i < RISCV_PMU_INLINE_NUM; i++) {
+        env->pmu_inline_events[i] -= extract64(counts,
+                                               i * RISCV_INSN_START_PMU_BITS,
+                                               RISCV_INSN_START_PMU_BITS);
+    }
+}
+
+static void riscv_pmu_update_inline_active(RISCVCPU *cpu)
+{
+    bool active = false;
+    int i;
+
+    for (i = 0; i < RISCV_PMU_INLINE_NUM; i++) {
+        if (g_hash_table_lookup(cpu->pmu_event_ctr_map,
+                                GUINT_TO_POINTER(pmu_inline_event_idx[i]))) {
+            active = true;
+        }
+    }
+    cpu->env.pmu_inline_active = active;
+}
+
 bool riscv_pmu_ctr_monitor_instructions(CPURISCVState *env,
                                         uint32_t target_ctr)
 {
@@ -394,6 +477,7 @@ int riscv_pmu_update_event_map(CPURISCVState *env, uint64_t value,
         g_hash_table_foreach_remove(cpu->pmu_event_ctr_map,
                                     pmu_remove_event_map,
                                     GUINT_TO_POINTER(ctr_idx));
+        riscv_pmu_update_inline_active(cpu);
         return 0;
     }
 
@@ -406,6 +490,9 @@ int riscv_pmu_update_event_map(CPURISCVState *env, uint64_t value,
     switch (event_idx) {
     case RISCV_PMU_EVENT_HW_CPU_CYCLES:
     case RISCV_PMU_EVENT_HW_INSTRUCTIONS:
+    case RISCV_PMU_EVENT_HW_BRANCH_INSTRUCTIONS:
+    case RISCV_PMU_EVENT_CACHE_L1D_READ_ACCESS:
+    case RISCV_PMU_EVENT_CACHE_L1D_WRITE_ACCESS:
     case RISCV_PMU_EVENT_CACHE_DTLB_READ_MISS:
     case RISCV_PMU_EVENT_CACHE_DTLB_WRITE_MISS:
     case RISCV_PMU_EVENT_CACHE_ITLB_PREFETCH_MISS:
@@ -416,6 +503,7 @@ int riscv_pmu_update_event_map(CPURISCVState *env, uint64_t value,
     }
     g_hash_table_insert(cpu->pmu_event_ctr_map, GUINT_TO_POINTER(event_idx),
                         GUINT_TO_POINTER(ctr_idx));
+    riscv_pmu_update_inline_active(cpu);
 
     return 0;
 }
@@ -129,8 +129,11 @@ static void riscv_restore_state_to_opc(CPUState *cs,
     } else {
         env->pc = pc;
     }
-    env->bins = data[1];
+    env->bins = (uint32_t)data[1];
     env->excp_uw2 = data[2];
+#ifndef CONFIG_USER_ONLY
+    riscv_pmu_unwind_inline_events(env, data[1] >> RISCV_INSN_START_PMU_SHIFT);
+#endif
 }
 
 static const TCGCPUOps riscv_tcg_ops = {
@@ -28,6 +28,9 @@
 #include "exec/translation-block.h"
 #include "exec/log.h"
 #include "semihosting/semihost.h"
+#ifdef CONFIG_USER_ONLY
+#include "user/libc-intercept.h"
+#endif
 
 #include "internals.h"
 
@@ -122,6 +125,26 @@ typedef struct DisasContext {
     bool fcfi_lp_expected;
     /* zicfiss extension, if shadow stack was enabled during TB gen */
     bool bcfi_enabled;
+    /*
+     * Destination register of an auipc in the current (auipc_rd) and
+     * previous (prev_auipc_rd) insn, and the value it computed.  This
+     * lets auipc+jalr far calls and tail calls use direct chaining.
+     */
+    int auipc_rd;
+    int prev_auipc_rd;
+    target_ulong auipc_val;
+    /*
+     * PMU events counted inline, and the counts of the current run of
+     * insns: pmu_run_insn is the insn_start of its first insn and
+     * pmu_run_mark the last op before the code of that insn.
+     */
+    bool pmu_events;
+    bool pmu_end_run;
+    uint16_t pmu_count[RISCV_PMU_INLINE_NUM];
+    TCGOp *pmu_run_insn;
+    TCGOp *pmu_run_mark;
+    /* Whether the TB may extend into the following page: -1 if unknown. */
+    int page1_ok;
 } DisasContext;
 
 static inline bool has_ext(DisasContext *ctx, uint32_t ext)
@@ -269,23 +292,135 @@ static void gen_exception_inst_addr_mis(DisasContext *ctx, TCGv target)
     generate_exception(ctx, RISCV_EXCP_INST_ADDR_MIS);
 }
 
-static void lookup_and_goto_ptr(DisasContext *ctx)
+/*
+ * Count one retired instruction against the icount triggers, and only
+ * call out to check them once the armed count runs out.  At the end of
+ * the TB the pc is already up to date; between instructions it must be
+ * written first, and the TB is left afterwards since the helper path
+ * does not track pc_save.
+ */
+static void gen_itrigger_tick(DisasContext *ctx, bool mid_tb)
 {
 #ifndef CONFIG_USER_ONLY
-    if (ctx->itrigger) {
-        gen_helper_itrigger_match(tcg_env);
+    TCGLabel *skip;
+    TCGv_i32 left;
+
+    if (!ctx->itrigger) {
+        return;
+    }
+
+    skip = gen_new_label();
+    left = tcg_temp_new_i32();
+    tcg_gen_ld_i32(left, tcg_env, offsetof(CPURISCVState, itrigger_left));
+    tcg_gen_subi_i32(left, left, 1);
+    tcg_gen_st_i32(left, tcg_env, offsetof(CPURISCVState, itrigger_left));
+    tcg_gen_brcondi_i32(TCG_COND_NE, left, 0, skip);
+    if (mid_tb) {
+        gen_pc_plus_diff(cpu_pc, ctx, 0);
     }
+    gen_helper_itrigger_match(tcg_env);
+    if (mid_tb) {
+        tcg_gen_lookup_and_goto_ptr();
+    }
+    gen_set_label(skip);
 #endif
-    tcg_gen_lookup_and_goto_ptr();
 }
 
-static void exit_tb(DisasContext *ctx)
+static inline void pmu_count_event(DisasContext *ctx, RISCVPMUInlineEvent ev)
+{
+    ctx->pmu_count[ev]++;
+}
+
+/*
+ * A run may count this many events of one kind, leaving room for the
+ * accesses of one more insn (at most 13, for cm.push and cm.pop).
+ */
+#define PMU_RUN_MAX ((1 << RISCV_INSN_START_PMU_BITS) - 16)
+
+/* The counts of the current run, packed as in insn start word 1 */
+static uint64_t pmu_run_counts(DisasContext *ctx)
+{
+    uint64_t counts = 0;
+    int i;
+
+    for (i = 0; i < RISCV_PMU_INLINE_NUM; i++) {
+        counts = deposit64(counts, i * RISCV_INSN_START_PMU_BITS,
+                           RISCV_INSN_START_PMU_BITS, ctx->pmu_count[i]);
+    }
+    return counts;
+}
+
+/*
+ * Add the loads, stores and branches of a run of insns to the per-vCPU
+ * PMU event counts at the start of the run, so that each enabled event
+ * costs one add per run rather than one per insn.  A run ends at the end
+ * of the TB and after an insn that reads a counter, which thus sees
+ * exactly the events of the insns before it.
+ *
+ * The insn start words record which counts belong to each insn and the
+ * rest of its run, so that an exception in the middle of the run takes
+ * them back (riscv_pmu_unwind_inline_events); the faulting insn and
+ * the ones after it are counted when they are executed again.
+ *
+ * AMOs and compare-and-swap count as both a load and a store, LR as a
+ * load and SC as a store.  Zcmp push and pop count one access per
+ * register, while vector loads and stores count once per insn,
+ * whatever their number of elements.
+ */
+static void gen_pmu_events(DisasContext *ctx)
 {
 #ifndef CONFIG_USER_ONLY
-    if (ctx->itrigger) {
-        gen_helper_itrigger_match(tcg_env);
+    uint64_t total;
+    TCGOp *op;
+    int i;
+
+    if (!ctx->pmu_events || !ctx->pmu_run_insn) {
+        return;
+    }
+
+    /* Turn the counts before each insn into those from it onward. */
+    total = pmu_run_counts(ctx);
+    for (op = ctx->pmu_run_insn; op; op = QTAILQ_NEXT(op, link)) {
+        if (op->opc == INDEX_op_insn_start) {
+            uint64_t word = tcg_get_insn_start_param(op, 1);
+            uint64_t before = word >> RISCV_INSN_START_PMU_SHIFT;
+
+            word = deposit64(word, RISCV_INSN_START_PMU_SHIFT,
+                             64 - RISCV_INSN_START_PMU_SHIFT, total - before);
+            tcg_set_insn_start_param(op, 1, word);
+        }
+    }
+
+    tcg_ctx->emit_before_op = QTAILQ_NEXT(ctx->pmu_run_mark, link);
+    for (i = 0; i < RISCV_PMU_INLINE_NUM; i++) {
+        size_t ofs = offsetof(CPURISCVState, pmu_inline_events[i]);
+        TCGv_i64 count;
+
+        if (!ctx->pmu_count[i]) {
+            continue;
+        }
+        count = tcg_temp_new_i64();
+        tcg_gen_ld_i64(count, tcg_env, ofs);
+        tcg_gen_addi_i64(count, count, ctx->pmu_count[i]);
+        tcg_gen_st_i64(count, tcg_env, ofs);
     }
+    tcg_ctx->emit_before_op = NULL;
 #endif
+
+    memset(ctx->pmu_count, 0, sizeof(ctx->pmu_count));
+    ctx->pmu_run_insn = NULL;
+    ctx->pmu_end_run = false;
+}
+
+static void lookup_and_goto_ptr(DisasContext *ctx)
+{
+    gen_itrigger_tick(ctx, false);
+    tcg_gen_lookup_and_goto_ptr();
+}
+
+static void exit_tb(DisasContext *ctx)
+{
+    gen_itrigger_tick(ctx, false);
     tcg_gen_exit_tb(NULL, 0);
 }
 
@@ -293,21 +428,19 @@ static void gen_goto_tb(DisasContext *ctx, int n, target_long diff)
 {
     target_ulong dest = ctx->base.pc_next + diff;
 
-     /*
-      * Under itrigger, instruction executes one by one like singlestep,
-      * direct block chain benefits will be small.
-      */
-    if (translator_use_goto_tb(&ctx->base, dest) && !ctx->itrigger) {
+    if (translator_use_goto_tb(&ctx->base, dest)) {
         /*
          * For pcrel, the pc must always be up-to-date on entry to
          * the linked TB, so that it can use simple additions for all
          * further adjustments.  For !pcrel, the linked TB is compiled
          * to know its full virtual address, so we can delay the
          * update to pc to the unlinked path.  A long chain of links
-         * can thus avoid many updates to the PC.
+         * can thus avoid many updates to the PC.  Icount triggers
+         * need it before the jump too, in case one fires.
          */
-        if (tb_cflags(ctx->base.tb) & CF_PCREL) {
+        if ((tb_cflags(ctx->base.tb) & CF_PCREL) || ctx->itrigger) {
             gen_update_pc(ctx, diff);
+            gen_itrigger_tick(ctx, false);
             tcg_gen_goto_tb(n);
         } else {
             tcg_gen_goto_tb(n);
@@ -320,6 +453,66 @@ static void gen_goto_tb(DisasContext *ctx, int n, target_long diff)
     }
 }
 
+/*
+ * Jump to the runtime address in @target, which is neither known at
+ * translation time nor allowed to change the TB flags.  Both goto_tb
+ * slots are used as a small inline cache: each is bound to the first
+ * target pc that exits through it, and later hits on that pc chain
+ * directly without going through the jump cache lookup.  A slot is
+ * freed again when its target TB is invalidated.  There is no other
+ * replacement, so this only pays off for jumps with few targets.
+ *
+ * The slots are read and written as a whole, which needs a 64-bit host.
+ */
+static void gen_goto_indirect(DisasContext *ctx, TCGv target)
+{
+    TranslationBlock *tb = ctx->base.tb;
+    TCGLabel *miss, *next;
+    TCGv_i64 dest, slot[2];
+    TCGv t0;
+    int n;
+
+    if (TCG_TARGET_REG_BITS != 64 || (tb_cflags(tb) & CF_NO_GOTO_TB)) {
+        tcg_gen_mov_tl(cpu_pc, target);
+        lookup_and_goto_ptr(ctx);
+        return;
+    }
+
+    /* As with direct jumps, only chain within the page of the TB. */
+    miss = gen_new_label();
+    t0 = tcg_temp_new();
+    gen_pc_plus_diff(t0, ctx, ctx->base.pc_first - ctx->base.pc_next);
+    tcg_gen_xor_tl(t0, t0, target);
+    tcg_gen_mov_tl(cpu_pc, target);
+    gen_itrigger_tick(ctx, false);
+    tcg_gen_brcondi_tl(TCG_COND_GEU, t0, TARGET_PAGE_SIZE, miss);
+
+    dest = tcg_temp_new_i64();
+    tcg_gen_extu_tl_i64(dest, target);
+    for (n = 0; n < 2; n++) {
+        slot[n] = tcg_temp_new_i64();
+        tcg_gen_ld_i64(slot[n], tcg_constant_ptr(&tb->jmp_pc[n]), 0);
+        next = gen_new_label();
+        tcg_gen_brcond_i64(TCG_COND_NE, slot[n], dest, next);
+        /* Unlinked, or unlinked again after the target was invalidated. */
+        tcg_gen_goto_tb(n);
+        tcg_gen_lookup_and_goto_ptr();
+        gen_set_label(next);
+        tb->jmp_indirect |= 1 << n;
+    }
+
+    /* Miss: let cpu_exec bind a free slot to this target. */
+    for (n = 0; n < 2; n++) {
+        next = gen_new_label();
+        tcg_gen_brcondi_i64(TCG_COND_NE, slot[n], -1, next);
+        tcg_gen_exit_tb(tb, n);
+        gen_set_label(next);
+    }
+
+    gen_set_label(miss);
+    tcg_gen_lookup_and_goto_ptr();
+}
+
 /*
  * Wrappers for getting reg values.
  *
@@ -568,6 +761,8 @@ static void gen_jal(DisasContext *ctx, int rd, target_ulong imm)
 {
     TCGv succ_pc = dest_gpr(ctx, rd);
 
+    pmu_count_event(ctx, RISCV_PMU_INLINE_BRANCH);
+
     /* check misaligned: */
     if (!has_ext(ctx, RVC) && !ctx->cfg_ptr->ext_zca) {
         if ((imm & 0x3) != 0) {
@@ -1101,6 +1296,8 @@ static bool gen_amo(DisasContext *ctx, arg_atomic *a,
     }
 
     decode_save_opc(ctx, RISCV_UW2_ALWAYS_STORE_AMO);
+    pmu_count_event(ctx, RISCV_PMU_INLINE_LOAD);
+    pmu_count_event(ctx, RISCV_PMU_INLINE_STORE);
     src1 = get_address(ctx, a->rs1, 0);
     func(dest, src1, src2, ctx->mem_idx, mop);
 
@@ -1115,6 +1312,8 @@ static bool gen_cmpxchg(DisasContext *ctx, arg_atomic *a, MemOp mop)
     TCGv src2 = get_gpr(ctx, a->rs2, EXT_NONE);
 
     decode_save_opc(ctx, RISCV_UW2_ALWAYS_STORE_AMO);
+    pmu_count_event(ctx, RISCV_PMU_INLINE_LOAD);
+    pmu_count_event(ctx, RISCV_PMU_INLINE_STORE);
     tcg_gen_atomic_cmpxchg_tl(dest, src1, dest, src2, ctx->mem_idx, mop);
 
     gen_set_gpr(ctx, a->rd, dest);
@@ -1256,6 +1455,12 @@ static void riscv_tr_init_disas_context(DisasContextBase *dcbase, CPUState *cs)
     ctx->zero = tcg_constant_tl(0);
     ctx->virt_inst_excp = false;
     ctx->decoders = cpu->decoders;
+    ctx->auipc_rd = 0;
+    ctx->page1_ok = -1;
+    ctx->pmu_events = FIELD_EX32(tb_flags, TB_FLAGS, PMU_EVENTS);
+    ctx->pmu_end_run = false;
+    memset(ctx->pmu_count, 0, sizeof(ctx->pmu_count));
+    ctx->pmu_run_insn = NULL;
 }
 
 static void riscv_tr_tb_start(DisasContextBase *db, CPUState *cpu)
@@ -1275,16 +1480,149 @@ static void riscv_tr_insn_start(DisasContextBase *dcbase, CPUState *cpu)
     ctx->insn_start_updated = false;
 }
 
+#ifdef CONFIG_USER_ONLY
+/*
+ * At the entry point of an intercepted libc routine, try the host
+ * implementation and return straight to the caller.  If it declines,
+ * e.g. because an argument points at unmapped memory, fall through
+ * and translate the guest's own code.
+ */
+static void gen_libc_intercept(DisasContext *ctx)
+{
+    LibcFunc func = libc_intercept_lookup(ctx->base.pc_next);
+    TCGLabel *fallback;
+    TCGv_i32 done;
+
+    if (func == LIBC_FUNC_NONE) {
+        return;
+    }
+
+    fallback = gen_new_label();
+    done = tcg_temp_new_i32();
+    gen_helper_libc_call(done, tcg_env, tcg_constant_i32(func));
+    tcg_gen_brcondi_i32(TCG_COND_EQ, done, 0, fallback);
+    tcg_gen_andi_tl(cpu_pc, cpu_gpr[xRA], (target_ulong)-2);
+    lookup_and_goto_ptr(ctx);
+    gen_set_label(fallback);
+}
+#endif
+
+#ifdef CONFIG_USER_ONLY
+/*
+ * Hot loops and long functions often straddle a page boundary, so allow
+ * a TB to continue into the page after its first one; the TB is then
+ * registered on both pages and revalidated against both on lookup.
+ * Only do so if the page can be fetched now without faulting, since a
+ * fault during translation would be raised before the preceding insns
+ * had executed, and if no breakpoint lives on it, since breakpoints
+ * only split the TBs that start on their page.
+ *
+ * This is limited to user mode: in system mode cpu_exec never chains
+ * into a TB spanning two pages, as the mapping of the second page may
+ * change under the jump.  There, two chained single-page TBs beat one
+ * two-page TB that every incoming branch has to look up again.
+ */
+static bool riscv_tr_page1_ok(DisasContext *ctx, CPUState *cs, vaddr page1)
+{
+    CPUBreakpoint *bp;
+    void *host;
+    int flags;
+
+    if (ctx->page1_ok >= 0) {
+        return ctx->page1_ok;
+    }
+    ctx->page1_ok = false;
+
+    if (tb_cflags(ctx->base.tb) & (CF_BP_PAGE | CF_NO_GOTO_TB)) {
+        return false;
+    }
+    QTAILQ_FOREACH(bp, &cs->breakpoints, entry) {
+        if (((bp->pc ^ page1) & TARGET_PAGE_MASK) == 0) {
+            return false;
+        }
+    }
+
+    flags = probe_access_flags(cpu_env(cs), page1, 0, MMU_INST_FETCH,
+                               cpu_mmu_index(cs, true), true, &host, 0);
+    if ((flags & (TLB_INVALID_MASK | TLB_MMIO)) || host == NULL) {
+        return false;
+    }
+
+    ctx->page1_ok = true;
+    return true;
+}
+#endif
+
+/* Return true if the insn byte at @addr may belong to this TB. */
+static bool riscv_tr_page_ok(DisasContext *ctx, CPUState *cs, vaddr addr)
+{
+    if (translator_is_same_page(&ctx->base, addr)) {
+        return true;
+    }
+#ifdef CONFIG_USER_ONLY
+    vaddr page1 = (ctx->base.pc_first & TARGET_PAGE_MASK) + TARGET_PAGE_SIZE;
+
+    return ((addr ^ page1) & TARGET_PAGE_MASK) == 0 &&
+           riscv_tr_page1_ok(ctx, cs, page1);
+#else
+    return false;
+#endif
+}
+
 static void riscv_tr_translate_insn(DisasContextBase *dcbase, CPUState *cpu)
 {
     DisasContext *ctx = container_of(dcbase, DisasContext, base);
     CPURISCVState *env = cpu_env(cpu);
     uint16_t opcode16 = translator_lduw(env, &ctx->base, ctx->base.pc_next);
+    uint64_t pmu_before = 0;
+
+#ifdef CONFIG_USER_ONLY
+    if (libc_intercept_enabled) {
+        gen_libc_intercept(ctx);
+    }
+#endif
+
+    /* The previous insn in this TB has retired. */
+    if (ctx->base.num_insns > 1) {
+        gen_itrigger_tick(ctx, true);
+    }
+
+    /*
+     * The counts of a run are added after the instruction trigger tick of
+     * the insn before it, which may leave the TB; with such ticks, every
+     * insn is a run of its own.
+     */
+    if (ctx->pmu_events) {
+        if (!ctx->pmu_run_insn) {
+            ctx->pmu_run_insn = ctx->base.insn_start;
+            ctx->pmu_run_mark = tcg_last_op();
+        }
+        pmu_before = pmu_run_counts(ctx);
+    }
 
     ctx->ol = ctx->xl;
+    ctx->prev_auipc_rd = ctx->auipc_rd;
+    ctx->auipc_rd = 0;
     decode_opc(env, ctx, opcode16);
     ctx->base.pc_next += ctx->cur_insn_len;
 
+    if (ctx->pmu_events) {
+        TCGOp *op = ctx->base.insn_start;
+        uint64_t word = tcg_get_insn_start_param(op, 1);
+
+        word = deposit64(word, RISCV_INSN_START_PMU_SHIFT,
+                         64 - RISCV_INSN_START_PMU_SHIFT, pmu_before);
+        tcg_set_insn_start_param(op, 1, word);
+        for (int i = 0; i < RISCV_PMU_INLINE_NUM; i++) {
+            if (ctx->pmu_count[i] > PMU_RUN_MAX) {
+                ctx->pmu_end_run = true;
+            }
+        }
+        if (ctx->pmu_end_run || ctx->itrigger) {
+            gen_pmu_events(ctx);
+        }
+    }
+
     /*
      * If 'fcfi_lp_expected' is still true after processing the instruction,
      * then we did not see an 'lpad' instruction, and must raise an exception.
@@ -1303,19 +1641,20 @@ static void riscv_tr_translate_insn(DisasContextBase *dcbase, CPUState *cpu)
         ctx->base.is_jmp = DISAS_NORETURN;
     }
 
-    /* Only the first insn within a TB is allowed to cross a page boundary. */
+    /* A TB may cover at most two pages; see riscv_tr_page_ok. */
     if (ctx->base.is_jmp == DISAS_NEXT) {
-        if (ctx->itrigger || !translator_is_same_page(&ctx->base, ctx->base.pc_next)) {
+        vaddr next = ctx->base.pc_next;
+
+        if (!riscv_tr_page_ok(ctx, cpu, next)) {
             ctx->base.is_jmp = DISAS_TOO_MANY;
         } else {
-            unsigned page_ofs = ctx->base.pc_next & ~TARGET_PAGE_MASK;
+            unsigned page_ofs = next & ~TARGET_PAGE_MASK;
 
             if (page_ofs > TARGET_PAGE_SIZE - MAX_INSN_LEN) {
-                uint16_t next_insn =
-                    translator_lduw(env, &ctx->base, ctx->base.pc_next);
+                uint16_t next_insn = translator_lduw(env, &ctx->base, next);
                 int len = insn_len(next_insn);
 
-                if (!translator_is_same_page(&ctx->base, ctx->base.pc_next + len - 1)) {
+                if (!riscv_tr_page_ok(ctx, cpu, next + len - 1)) {
                     ctx->base.is_jmp = DISAS_TOO_MANY;
                 }
             }
@@ -1327,6 +1666,8 @@ static void riscv_tr_tb_stop(DisasContextBase *dcbase, CPUState *cpu)
 {
     DisasContext *ctx = container_of(dcbase, DisasContext, base);
 
+    gen_pmu_events(ctx);
+
     switch (ctx->base.is_jmp) {
     case DISAS_TOO_MANY:
         gen_goto_tb(ctx, 0, 0);
@@ -43,6 +43,7 @@ typedef struct MemCopyInfo {
     QSIMPLEQ_ENTRY (MemCopyInfo) next;
     TCGTemp *ts;
     TCGType type;
+    bool sext;      /* narrow load: ts holds the sign-extended value */
 } MemCopyInfo;
 
 typedef struct TempOptInfo {
@@ -258,8 +259,8 @@ static void reset_temp(OptContext *ctx, TCGArg arg)
     reset_ts(ctx, arg_temp(arg));
 }
 
-static void record_mem_copy(OptContext *ctx, TCGType type,
-                            TCGTemp *ts, intptr_t start, intptr_t last)
+static void record_mem_copy(OptContext *ctx, TCGType type, TCGTemp *ts,
+                            intptr_t start, intptr_t last, bool sext)
 {
     MemCopyInfo *mc;
     TempOptInfo *ti;
@@ -275,6 +276,7 @@ static void record_mem_copy(OptContext *ctx, TCGType type,
     mc->itree.start = start;
     mc->itree.last = last;
     mc->type = type;
+    mc->sext = sext;
     interval_tree_insert(&mc->itree, &ctx->mem_copy);
 
     ts = find_better_copy(ts);
@@ -309,12 +311,14 @@ static bool args_are_copies(TCGArg arg1, TCGArg arg2)
     return ts_are_copies(arg_temp(arg1), arg_temp(arg2));
 }
 
-static TCGTemp *find_mem_copy_for(OptContext *ctx, TCGType type, intptr_t s)
+static TCGTemp *find_mem_copy_for(OptContext *ctx, TCGType type,
+                                  intptr_t s, intptr_t l, bool sext)
 {
     MemCopyInfo *mc;
 
     for (mc = mem_copy_first(ctx, s, s); mc; mc = mem_copy_next(mc, s, s)) {
-        if (mc->itree.start == s && mc->type == type) {
+        if (mc->itree.start == s && mc->itree.last == l &&
+            mc->type == type && mc->sext == sext) {
             return find_better_copy(mc->ts);
         }
     }
@@ -2696,37 +2700,60 @@ static bool fold_sub2(OptContext *ctx, TCGOp *op)
 static bool fold_tcg_ld(OptContext *ctx, TCGOp *op)
 {
     uint64_t z_mask = -1, s_mask = 0;
+    intptr_t ofs = op->args[2];
+    intptr_t lm1;
+    TCGTemp *src;
 
-    /* We can't do any folding with a load, but we can record bits. */
     switch (op->opc) {
     CASE_OP_32_64(ld8s):
         s_mask = INT8_MIN;
+        lm1 = 0;
         break;
     CASE_OP_32_64(ld8u):
         z_mask = MAKE_64BIT_MASK(0, 8);
+        lm1 = 0;
         break;
     CASE_OP_32_64(ld16s):
         s_mask = INT16_MIN;
+        lm1 = 1;
         break;
     CASE_OP_32_64(ld16u):
         z_mask = MAKE_64BIT_MASK(0, 16);
+        lm1 = 1;
         break;
     case INDEX_op_ld32s_i64:
         s_mask = INT32_MIN;
+        lm1 = 3;
         break;
     case INDEX_op_ld32u_i64:
         z_mask = MAKE_64BIT_MASK(0, 32);
+        lm1 = 3;
         break;
     default:
         g_assert_not_reached();
     }
-    return fold_masks_zs(ctx, op, z_mask, s_mask);
+
+    if (op->args[1] != tcgv_ptr_arg(tcg_env)) {
+        /* We can't do any folding with a load, but we can record bits. */
+        return fold_masks_zs(ctx, op, z_mask, s_mask);
+    }
+
+    /* Reuse an earlier load of the same env field with the same extension. */
+    src = find_mem_copy_for(ctx, ctx->type, ofs, ofs + lm1, s_mask != 0);
+    if (src && src->base_type == ctx->type) {
+        return tcg_opt_gen_mov(ctx, op, op->args[0], temp_arg(src));
+    }
+
+    fold_masks_zs(ctx, op, z_mask, s_mask);
+    record_mem_copy(ctx, ctx->type, arg_temp(op->args[0]),
+                    ofs, ofs + lm1, s_mask != 0);
+    return true;
 }
 
 static bool fold_tcg_ld_memcopy(OptContext *ctx, TCGOp *op)
 {
     TCGTemp *dst, *src;
-    intptr_t ofs;
+    intptr_t ofs, last;
     TCGType type;
 
     if (op->args[1] != tcgv_ptr_arg(tcg_env)) {
@@ -2736,13 +2763,14 @@ static bool fold_tcg_ld_memcopy(OptContext *ctx, TCGOp *op)
     type = ctx->type;
     ofs = op->args[2];
     dst = arg_temp(op->args[0]);
-    src = find_mem_copy_for(ctx, type, ofs);
+    last = ofs + tcg_type_size(type) - 1;
+    src = find_mem_copy_for(ctx, type, ofs, last, false);
     if (src && src->base_type == type) {
         return tcg_opt_gen_mov(ctx, op, temp_arg(dst), temp_arg(src));
     }
 
     reset_ts(ctx, dst);
-    record_mem_copy(ctx, type, dst, ofs, ofs + tcg_type_size(type) - 1);
+    record_mem_copy(ctx, type, dst, ofs, last, false);
     return true;
 }
 
@@ -2794,21 +2822,22 @@ static bool fold_tcg_st_memcopy(OptContext *ctx, TCGOp *op)
     ofs = op->args[2];
     type = ctx->type;
 
+    last = ofs + tcg_type_size(type) - 1;
+
     /*
      * Eliminate duplicate stores of a constant.
      * This happens frequently when the target ISA zero-extends.
      */
     if (ts_is_const(src)) {
-        TCGTemp *prev = find_mem_copy_for(ctx, type, ofs);
+        TCGTemp *prev = find_mem_copy_for(ctx, type, ofs, last, false);
         if (src == prev) {
             tcg_op_remove(ctx->tcg, op);
             return true;
         }
     }
 
-    last = ofs + tcg_type_size(type) - 1;
     remove_mem_copy_in(ctx, ofs, last);
-    record_mem_copy(ctx, type, src, ofs, last);
+    record_mem_copy(ctx, type, src, ofs, last, false);
     return true;
 }
 
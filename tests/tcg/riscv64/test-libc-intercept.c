@@ -0,0 +1,126 @@
+/*
+ * Check the results of the string routines that -libc-intercept runs
+ * with the host C library, including a strlen that crosses into the
+ * next page and accesses that fault, where the guest's own code must
+ * run and take the fault.  Whether the calls were intercepted at all
+ * is checked by the Makefile, in the libc_intercept_call trace.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include <assert.h>
+#include <setjmp.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+/* Call through pointers so that the compiler cannot inline the calls. */
+static void *(*volatile p_memcpy)(void *, const void *, size_t) = memcpy;
+static void *(*volatile p_memmove)(void *, const void *, size_t) = memmove;
+static void *(*volatile p_memset)(void *, int, size_t) = memset;
+static int (*volatile p_memcmp)(const void *, const void *, size_t) = memcmp;
+static size_t (*volatile p_strlen)(const char *) = strlen;
+
+static sigjmp_buf jmp_env;
+
+static void sigsegv_handler(int sig)
+{
+    siglongjmp(jmp_env, 1);
+}
+
+static void test_mem(void)
+{
+    char a[256], b[256];
+    int i;
+
+    for (i = 0; i < sizeof(a); i++) {
+        a[i] = i;
+    }
+
+    p_memset(b, 0x5a, sizeof(b));
+    for (i = 0; i < sizeof(b); i++) {
+        assert(b[i] == 0x5a);
+    }
+
+    p_memcpy(b + 1, a, 100);
+    assert(b[0] == 0x5a && b[101] == 0x5a);
+    for (i = 0; i < 100; i++) {
+        assert(b[i + 1] == a[i]);
+    }
+
+    /* Overlapping, in both directions */
+    p_memcpy(b, a, sizeof(a));
+    p_memmove(b + 10, b, 100);
+    for (i = 0; i < 100; i++) {
+        assert(b[i + 10] == a[i]);
+    }
+    p_memcpy(b, a, sizeof(a));
+    p_memmove(b, b + 10, 100);
+    for (i = 0; i < 100; i++) {
+        assert(b[i] == a[i + 10]);
+    }
+
+    p_memcpy(b, a, sizeof(a));
+    assert(p_memcmp(a, b, sizeof(a)) == 0);
+    b[200] = 0;
+    assert(p_memcmp(a, b, sizeof(a)) > 0);
+    assert(p_memcmp(b, a, sizeof(a)) < 0);
+    assert(p_memcmp(a, b, 200) == 0);
+    assert(p_memcmp(a, b, 0) == 0);
+
+    assert(p_strlen("") == 0);
+    assert(p_strlen("hello") == 5);
+}
+
+static void test_pages(void)
+{
+    long psize = sysconf(_SC_PAGESIZE);
+    char *p = mmap(NULL, 2 * psize, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    char buf[16];
+
+    assert(p != MAP_FAILED);
+
+    /* A string that starts near the end of one page and ends in the next */
+    p_memset(p, 'x', 2 * psize);
+    p[psize + 10] = 0;
+    assert(p_strlen(p + psize - 20) == 30);
+
+    /* Make the second page inaccessible: the guest code must fault */
+    assert(mprotect(p + psize, psize, PROT_NONE) == 0);
+    signal(SIGSEGV, sigsegv_handler);
+
+    if (sigsetjmp(jmp_env, 1) == 0) {
+        p_strlen(p + psize - 20);
+        assert(0);
+    }
+    if (sigsetjmp(jmp_env, 1) == 0) {
+        p_memcpy(buf, p + psize - 4, sizeof(buf));
+        assert(0);
+    }
+    if (sigsetjmp(jmp_env, 1) == 0) {
+        p_memset(p + psize - 4, 0, 8);
+        assert(0);
+    }
+
+    /* Read-only: loads work, stores fault */
+    assert(mprotect(p + psize, psize, PROT_READ) == 0);
+    assert(p_strlen(p + psize - 20) == 30);
+    if (sigsetjmp(jmp_env, 1) == 0) {
+        p_memcpy(p + psize - 4, buf, sizeof(buf));
+        assert(0);
+    }
+    /* The read-only page itself must be untouched */
+    assert(p[psize] == 'x');
+
+    signal(SIGSEGV, SIG_DFL);
+    munmap(p, 2 * psize);
+}
+
+int main(void)
+{
+    test_mem();
+    test_pages();
+    return 0;
+}